@@ -0,0 +1,100 @@
+// File:  preparedGeometryBenchmark.cpp
+// Date:  10/18/2026
+// Auth:  K. Loux
+// Desc:  Timing harness comparing PreparedGeometry against ray-casting for point-in-polygon tests.
+
+// Built with "make benchmark" (not part of the default build).  Usage:
+//   bin/preparedGeometryBenchmark <boundary KML file> [point count]
+// The KML file must contain a single placemark (same requirement as the KML filter), e.g. a large county
+// boundary.  Points are drawn uniformly from the boundary's bounding box.
+
+// Local headers
+#include "kmlLibraryManager.h"
+#include "preparedGeometry.h"
+#include "utilities/uString.h"
+
+// Standard C++ headers
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <cstdlib>
+
+typedef std::chrono::steady_clock Clock;
+
+static double ElapsedNanoseconds(const Clock::time_point& start, const Clock::time_point& end)
+{
+	return std::chrono::duration<double, std::nano>(end - start).count();
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc != 2 && argc != 3)
+	{
+		Cout << "Usage:  " << argv[0] << " <boundary KML file> [point count]" << std::endl;
+		return 1;
+	}
+
+	const std::size_t pointCount(argc == 3 ? std::strtoul(argv[2], nullptr, 10) : 1000000);
+	const std::size_t bruteForceCount(std::min(pointCount, static_cast<std::size_t>(10000)));// Ray-casting is too slow to check every point
+	if (pointCount == 0)
+	{
+		Cerr << "Point count must be positive\n";
+		return 1;
+	}
+
+	const auto geometry(KMLLibraryManager::ReadKML(UString::ToStringType(argv[1])));
+	if (!geometry)
+		return 1;
+
+	std::size_t vertexCount(0);
+	for (const auto& polygon : geometry->GetPolygons())
+		vertexCount += polygon.size();
+
+	const auto buildStart(Clock::now());
+	const PreparedGeometry prepared(*geometry);
+	const auto buildEnd(Clock::now());
+
+	std::mt19937 generator(1);
+	std::uniform_real_distribution<double> longitudeDistribution(geometry->bbox.southWest.longitude, geometry->bbox.northEast.longitude);
+	std::uniform_real_distribution<double> latitudeDistribution(geometry->bbox.southWest.latitude, geometry->bbox.northEast.latitude);
+	std::vector<double> longitudes(pointCount), latitudes(pointCount);
+	for (std::size_t i = 0; i < pointCount; ++i)
+	{
+		longitudes[i] = longitudeDistribution(generator);
+		latitudes[i] = latitudeDistribution(generator);
+	}
+
+	const auto singleStart(Clock::now());
+	std::size_t insideCount(0);
+	for (std::size_t i = 0; i < pointCount; ++i)
+	{
+		if (prepared.ContainsPoint(KMLLibraryManager::GeometryInfo::Point(longitudes[i], latitudes[i])))
+			++insideCount;
+	}
+	const auto singleEnd(Clock::now());
+
+	std::vector<uint8_t> inside;
+	const auto batchStart(Clock::now());
+	prepared.ContainsPoints(longitudes, latitudes, inside);
+	const auto batchEnd(Clock::now());
+
+	std::size_t mismatchCount(0);
+	const auto bruteForceStart(Clock::now());
+	for (std::size_t i = 0; i < bruteForceCount; ++i)
+	{
+		if (KMLLibraryManager::PointIsWithinPolygons(KMLLibraryManager::GeometryInfo::Point(longitudes[i], latitudes[i]), *geometry) != (inside[i] == 1))
+			++mismatchCount;
+	}
+	const auto bruteForceEnd(Clock::now());
+
+	Cout << "Vertices:                " << vertexCount << '\n'
+		<< "Points (inside):         " << pointCount << " (" << insideCount << ")\n"
+		<< "Prepare:                 " << ElapsedNanoseconds(buildStart, buildEnd) * 1.0e-6 << " ms\n"
+		<< "ContainsPoint:           " << ElapsedNanoseconds(singleStart, singleEnd) / pointCount << " ns/point\n"
+		<< "ContainsPoints:          " << ElapsedNanoseconds(batchStart, batchEnd) / pointCount << " ns/point\n"
+		<< "PointIsWithinPolygons:   " << ElapsedNanoseconds(bruteForceStart, bruteForceEnd) / bruteForceCount << " ns/point\n"
+		<< "Mismatches:              " << mismatchCount << " of " << bruteForceCount << std::endl;
+
+	return mismatchCount == 0 ? 0 : 1;
+}
@@ -0,0 +1,52 @@
+// File:  binaryIO.cpp
+// Date:  10/18/2026
+// Auth:  K. Loux
+// Desc:  Raw binary reading and writing for the cache files.
+
+// Local headers
+#include "binaryIO.h"
+
+namespace BinaryIO
+{
+
+const uint64_t initialHash(14695981039346656037ULL);
+
+// Small counts are not checked, since they can't cause large allocations (and seeking to check
+// the file size for every value would be slow); reading the elements fails instead
+static bool RemainingBytesAtLeast(std::istream& file, const uint64_t& byteCount)
+{
+	const uint64_t uncheckedSize(1048576);
+	if (byteCount <= uncheckedSize)
+		return true;
+
+	const auto position(file.tellg());
+	if (position < 0 || !file.seekg(0, std::ios::end))
+		return false;
+
+	const auto end(file.tellg());
+	file.seekg(position);
+	return end >= position && static_cast<uint64_t>(end - position) >= byteCount && file.good();
+}
+
+bool ReadCount(std::istream& file, const std::size_t& minimumElementSize, uint32_t& count)
+{
+	return Read(file, count) && RemainingBytesAtLeast(file, static_cast<uint64_t>(count) * minimumElementSize);
+}
+
+uint64_t ComputeHash(const char* data, const std::size_t& size, uint64_t hash)
+{
+	for (std::size_t i = 0; i < size; ++i)
+	{
+		hash ^= static_cast<uint8_t>(data[i]);
+		hash *= 1099511628211ULL;
+	}
+
+	return hash;
+}
+
+uint64_t ComputeHash(const std::string& data, uint64_t hash)
+{
+	return ComputeHash(data.data(), data.size(), hash);
+}
+
+}// namespace BinaryIO
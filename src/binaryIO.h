@@ -0,0 +1,100 @@
+// File:  binaryIO.h
+// Date:  10/18/2026
+// Auth:  K. Loux
+// Desc:  Raw binary reading and writing for the cache files.
+
+#ifndef BINARY_IO_H_
+#define BINARY_IO_H_
+
+// Standard C++ headers
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+
+// Values are written in native byte order, so files are only read on the machine which wrote them.
+// Element counts are stored as uint32.  Reading fails (instead of allocating) when a count is larger
+// than the rest of the file could hold, so a corrupt file only causes the cache to be rebuilt.
+namespace BinaryIO
+{
+template<typename T>
+bool Write(std::ostream& file, const T& data);
+template<typename T>
+bool Read(std::istream& file, T& data);
+template<typename T>
+bool WriteVector(std::ostream& file, const std::vector<T>& v);
+template<typename T>
+bool ReadVector(std::istream& file, std::vector<T>& v);
+template<typename Char>
+bool WriteString(std::ostream& file, const std::basic_string<Char>& s);
+template<typename Char>
+bool ReadString(std::istream& file, std::basic_string<Char>& s);
+
+// For reading the count of a container whose elements occupy at least minimumElementSize bytes in the file
+bool ReadCount(std::istream& file, const std::size_t& minimumElementSize, uint32_t& count);
+
+extern const uint64_t initialHash;
+uint64_t ComputeHash(const char* data, const std::size_t& size, uint64_t hash = initialHash);// 64-bit FNV-1a; pass previous result to combine
+uint64_t ComputeHash(const std::string& data, uint64_t hash = initialHash);
+}
+
+template<typename T>
+bool BinaryIO::Write(std::ostream& file, const T& data)
+{
+	file.write(reinterpret_cast<const char*>(&data), sizeof(data));
+	return file.good();
+}
+
+template<typename T>
+bool BinaryIO::Read(std::istream& file, T& data)
+{
+	file.read(reinterpret_cast<char*>(&data), sizeof(data));
+	return file.gcount() == sizeof(data);
+}
+
+template<typename T>
+bool BinaryIO::WriteVector(std::ostream& file, const std::vector<T>& v)
+{
+	if (!Write(file, static_cast<uint32_t>(v.size())))
+		return false;
+	file.write(reinterpret_cast<const char*>(v.data()), v.size() * sizeof(T));
+	return file.good();
+}
+
+template<typename T>
+bool BinaryIO::ReadVector(std::istream& file, std::vector<T>& v)
+{
+	uint32_t size;
+	if (!ReadCount(file, sizeof(T), size))
+		return false;
+
+	v.resize(size);
+	const std::streamsize byteCount(static_cast<std::streamsize>(size) * sizeof(T));
+	file.read(reinterpret_cast<char*>(v.data()), byteCount);
+	return file.gcount() == byteCount;
+}
+
+template<typename Char>
+bool BinaryIO::WriteString(std::ostream& file, const std::basic_string<Char>& s)
+{
+	if (!Write(file, static_cast<uint32_t>(s.size())))
+		return false;
+	file.write(reinterpret_cast<const char*>(s.data()), s.size() * sizeof(Char));
+	return file.good();
+}
+
+template<typename Char>
+bool BinaryIO::ReadString(std::istream& file, std::basic_string<Char>& s)
+{
+	uint32_t length;
+	if (!ReadCount(file, sizeof(Char), length))
+		return false;
+
+	s.resize(length);
+	const std::streamsize byteCount(static_cast<std::streamsize>(length) * sizeof(Char));
+	file.read(reinterpret_cast<char*>(&s[0]), byteCount);
+	return file.gcount() == byteCount;
+}
+
+#endif// BINARY_IO_H_
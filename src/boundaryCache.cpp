@@ -0,0 +1,301 @@
+// File:  boundaryCache.cpp
+// Date:  10/18/2026
+// Auth:  K. Loux
+// Desc:  Binary cache of preprocessed region boundaries, stored alongside the KML library.
+
+// Local headers
+#include "boundaryCache.h"
+#include "binaryIO.h"
+
+// Standard C++ headers
+#include <algorithm>
+#include <cmath>
+#include <cctype>
+#include <cstdlib>
+#include <limits>
+#include <filesystem>
+
+const UString::String BoundaryCache::fileExtension(_T(".boundaries"));
+const uint16_t BoundaryCache::cacheVersion(2);
+const int BoundaryCache::maxFixedPointPrecision(7);// 180 deg * 10^7 still fits in an int32_t
+
+BoundaryCache::BoundaryCache(const UString::String& fileName, const int& precision) : fileName(fileName),
+	precision(precision), useFixedPoint(precision >= 0 && precision <= maxFixedPointPrecision), fixedPointScale(std::pow(10.0, precision))
+{
+}
+
+bool BoundaryCache::GetArchiveFileInfo(const UString::String& archiveFileName, ArchiveInfo& info)
+{
+	const std::filesystem::path path(archiveFileName);
+	std::error_code error;
+	info.size = std::filesystem::file_size(path, error);
+	if (error)
+		return false;
+
+	const auto modifiedTime(std::filesystem::last_write_time(path, error));
+	if (error)
+		return false;
+
+	info.modifiedTime = static_cast<int64_t>(modifiedTime.time_since_epoch().count());
+	return true;
+}
+
+// 64-bit FNV-1a hash of the raw archive bytes
+bool BoundaryCache::ComputeArchiveHash(const UString::String& archiveFileName, uint64_t& hash)
+{
+	std::ifstream file(archiveFileName.c_str(), std::ios::binary);
+	if (!file.is_open() || !file.good())
+		return false;
+
+	hash = BinaryIO::initialHash;
+	std::vector<char> chunk(1048576);
+	while (file.read(chunk.data(), chunk.size()), file.gcount() > 0)
+		hash = BinaryIO::ComputeHash(chunk.data(), static_cast<std::size_t>(file.gcount()), hash);
+
+	return true;
+}
+
+bool BoundaryCache::ReadArchiveInfo(ArchiveInfo& info) const
+{
+	std::ifstream file(fileName.c_str(), std::ios::binary);
+	if (!file.is_open() || !file.good())
+		return false;
+
+	int32_t cachePrecision;
+	return ReadHeader(file, info, cachePrecision);
+}
+
+// Returns false if the file was written by a different version
+bool BoundaryCache::ReadHeader(std::ifstream& file, ArchiveInfo& archive, int32_t& cachePrecision)
+{
+	uint16_t version;
+	return BinaryIO::Read(file, version) && version == cacheVersion &&
+		BinaryIO::Read(file, archive.size) && BinaryIO::Read(file, archive.modifiedTime) && BinaryIO::Read(file, archive.hash) &&
+		BinaryIO::Read(file, cachePrecision);
+}
+
+bool BoundaryCache::Load(const uint64_t& archiveHash, std::vector<Region>& regions) const
+{
+	std::ifstream file(fileName.c_str(), std::ios::binary);
+	if (!file.is_open() || !file.good())
+		return false;
+
+	ArchiveInfo archive;
+	int32_t cachePrecision;
+	if (!ReadHeader(file, archive, cachePrecision) || archive.hash != archiveHash || cachePrecision != precision)
+		return false;
+
+	uint32_t regionCount;
+	if (!BinaryIO::ReadCount(file, sizeof(uint32_t), regionCount))// Each region begins with its name length
+		return false;
+
+	std::vector<Region> cachedRegions(regionCount);
+	for (auto& region : cachedRegions)
+	{
+		if (!LoadRegion(file, region))
+			return false;
+	}
+
+	regions = std::move(cachedRegions);
+	return true;
+}
+
+// Data is written to a temporary file which then replaces the cache file, so an interrupted
+// write can't leave a truncated cache behind
+bool BoundaryCache::Save(const ArchiveInfo& archive, const std::vector<Region>& regions) const
+{
+	const std::filesystem::path path(fileName);
+	std::filesystem::path tempPath(path);
+	tempPath += ".transaction";
+
+	{
+		std::ofstream file(tempPath, std::ios::binary);
+		if (!file.is_open() || !file.good())
+			return false;
+
+		bool ok(BinaryIO::Write(file, cacheVersion) &&
+			BinaryIO::Write(file, archive.size) && BinaryIO::Write(file, archive.modifiedTime) && BinaryIO::Write(file, archive.hash) &&
+			BinaryIO::Write(file, static_cast<int32_t>(precision)) &&
+			BinaryIO::Write(file, static_cast<uint32_t>(regions.size())));
+		for (auto region = regions.cbegin(); ok && region != regions.cend(); ++region)
+			ok = SaveRegion(file, *region);
+
+		file.close();
+		if (!ok || file.fail())
+		{
+			std::error_code error;
+			std::filesystem::remove(tempPath, error);
+			return false;
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(tempPath, path, error);
+	return !error;
+}
+
+bool BoundaryCache::LoadRegion(std::ifstream& file, Region& region) const
+{
+	if (!BinaryIO::ReadString(file, region.name) ||
+		!BinaryIO::Read(file, region.minLongitude) || !BinaryIO::Read(file, region.minLatitude) ||
+		!BinaryIO::Read(file, region.maxLongitude) || !BinaryIO::Read(file, region.maxLatitude) ||
+		!BinaryIO::ReadVector(file, region.polygonStarts) || !BinaryIO::ReadVector(file, region.ringStarts))
+		return false;
+
+	// Vertices are interleaved (longitude, latitude)
+	if (useFixedPoint)
+	{
+		std::vector<int32_t> vertices;
+		if (!BinaryIO::ReadVector(file, vertices) || vertices.size() % 2 != 0)
+			return false;
+
+		region.longitudes.resize(vertices.size() / 2);
+		region.latitudes.resize(vertices.size() / 2);
+		for (std::size_t i = 0; i < region.longitudes.size(); ++i)
+		{
+			region.longitudes[i] = vertices[2 * i] / fixedPointScale;
+			region.latitudes[i] = vertices[2 * i + 1] / fixedPointScale;
+		}
+	}
+	else
+	{
+		std::vector<double> vertices;
+		if (!BinaryIO::ReadVector(file, vertices) || vertices.size() % 2 != 0)
+			return false;
+
+		region.longitudes.resize(vertices.size() / 2);
+		region.latitudes.resize(vertices.size() / 2);
+		for (std::size_t i = 0; i < region.longitudes.size(); ++i)
+		{
+			region.longitudes[i] = vertices[2 * i];
+			region.latitudes[i] = vertices[2 * i + 1];
+		}
+	}
+
+	return !region.polygonStarts.empty() && !region.ringStarts.empty() &&
+		region.polygonStarts.back() == region.ringStarts.size() - 1 &&
+		region.ringStarts.back() == region.longitudes.size();
+}
+
+bool BoundaryCache::SaveRegion(std::ofstream& file, const Region& region) const
+{
+	if (!BinaryIO::WriteString(file, region.name) ||
+		!BinaryIO::Write(file, region.minLongitude) || !BinaryIO::Write(file, region.minLatitude) ||
+		!BinaryIO::Write(file, region.maxLongitude) || !BinaryIO::Write(file, region.maxLatitude) ||
+		!BinaryIO::WriteVector(file, region.polygonStarts) || !BinaryIO::WriteVector(file, region.ringStarts))
+		return false;
+
+	if (useFixedPoint)
+	{
+		const double limit(std::numeric_limits<int32_t>::max());
+		std::vector<int32_t> vertices(region.longitudes.size() * 2);
+		for (std::size_t i = 0; i < region.longitudes.size(); ++i)
+		{
+			const double scaledLongitude(std::round(region.longitudes[i] * fixedPointScale));
+			const double scaledLatitude(std::round(region.latitudes[i] * fixedPointScale));
+			if (std::abs(scaledLongitude) > limit || std::abs(scaledLatitude) > limit)
+				return false;
+
+			vertices[2 * i] = static_cast<int32_t>(scaledLongitude);
+			vertices[2 * i + 1] = static_cast<int32_t>(scaledLatitude);
+		}
+
+		return BinaryIO::WriteVector(file, vertices);
+	}
+
+	std::vector<double> vertices(region.longitudes.size() * 2);
+	for (std::size_t i = 0; i < region.longitudes.size(); ++i)
+	{
+		vertices[2 * i] = region.longitudes[i];
+		vertices[2 * i + 1] = region.latitudes[i];
+	}
+
+	return BinaryIO::WriteVector(file, vertices);
+}
+
+// Builds region from the geometry portion of a placemark (<MultiGeometry> or <Polygon>)
+bool BoundaryCache::BuildRegion(const UString::String& name, const std::string& kml, Region& region)
+{
+	region = Region();
+	region.name = name;
+	region.polygonStarts.push_back(0);
+	region.ringStarts.push_back(0);
+
+	const std::string polygonStartTag("<Polygon>");
+	const std::string polygonEndTag("</Polygon>");
+	const std::string coordinatesStartTag("<coordinates>");
+	const std::string coordinatesEndTag("</coordinates>");
+
+	std::string::size_type polygonStart(0);
+	while (polygonStart = kml.find(polygonStartTag, polygonStart), polygonStart != std::string::npos)
+	{
+		const auto polygonEnd(kml.find(polygonEndTag, polygonStart));
+		if (polygonEnd == std::string::npos)
+			return false;
+
+		auto ringStart(polygonStart);
+		while (ringStart = kml.find(coordinatesStartTag, ringStart), ringStart < polygonEnd)
+		{
+			ringStart += coordinatesStartTag.length();
+			const auto ringEnd(kml.find(coordinatesEndTag, ringStart));
+			if (ringEnd == std::string::npos || ringEnd > polygonEnd)
+				return false;
+
+			if (!ParseRing(kml.substr(ringStart, ringEnd - ringStart), region))
+				return false;
+			region.ringStarts.push_back(static_cast<uint32_t>(region.longitudes.size()));
+			ringStart = ringEnd;
+		}
+
+		if (region.ringStarts.size() - 1 > region.polygonStarts.back())
+			region.polygonStarts.push_back(static_cast<uint32_t>(region.ringStarts.size() - 1));
+		polygonStart = polygonEnd;
+	}
+
+	ComputeBoundingBox(region);
+	return true;
+}
+
+// Coordinates are longitude,latitude[,altitude] tuples separated by whitespace
+bool BoundaryCache::ParseRing(const std::string& coordinates, Region& region)
+{
+	const char* position(coordinates.c_str());
+	while (true)
+	{
+		while (std::isspace(static_cast<unsigned char>(*position)))
+			++position;
+		if (*position == '\0')
+			return true;
+
+		char* end;
+		const double longitude(std::strtod(position, &end));
+		if (end == position || *end != ',')
+			return false;
+
+		position = end + 1;
+		const double latitude(std::strtod(position, &end));
+		if (end == position)
+			return false;
+
+		position = end;
+		while (*position != '\0' && !std::isspace(static_cast<unsigned char>(*position)))
+			++position;
+
+		region.longitudes.push_back(longitude);
+		region.latitudes.push_back(latitude);
+	}
+}
+
+void BoundaryCache::ComputeBoundingBox(Region& region)
+{
+	if (region.longitudes.empty())
+		return;
+
+	const auto longitudeRange(std::minmax_element(region.longitudes.cbegin(), region.longitudes.cend()));
+	const auto latitudeRange(std::minmax_element(region.latitudes.cbegin(), region.latitudes.cend()));
+	region.minLongitude = *longitudeRange.first;
+	region.maxLongitude = *longitudeRange.second;
+	region.minLatitude = *latitudeRange.first;
+	region.maxLatitude = *latitudeRange.second;
+}
+
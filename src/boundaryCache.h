@@ -0,0 +1,77 @@
+// File:  boundaryCache.h
+// Date:  10/18/2026
+// Auth:  K. Loux
+// Desc:  Binary cache of preprocessed region boundaries, stored alongside the KML library.
+
+#ifndef BOUNDARY_CACHE_H_
+#define BOUNDARY_CACHE_H_
+
+// Local headers
+#include "utilities/uString.h"
+
+// Standard C++ headers
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <fstream>
+
+// Cache files are keyed by a hash of the source archive and the coordinate precision, so
+// any change to the archive (including corrections made by KMLLibraryManager) causes the
+// cache to be rebuilt.  The archive's size and modification time are also stored, so the
+// hash only needs to be recomputed when one of them changes.
+class BoundaryCache
+{
+public:
+	BoundaryCache(const UString::String& fileName, const int& precision);
+
+	static const UString::String fileExtension;
+
+	struct ArchiveInfo
+	{
+		uint64_t size = 0;// [bytes]
+		int64_t modifiedTime = 0;// Only meaningful for comparison with other values from GetArchiveFileInfo()
+		uint64_t hash = 0;
+	};
+
+	static bool GetArchiveFileInfo(const UString::String& archiveFileName, ArchiveInfo& info);// Sets size and modification time only
+	static bool ComputeArchiveHash(const UString::String& archiveFileName, uint64_t& hash);
+	bool ReadArchiveInfo(ArchiveInfo& info) const;// Archive information stored in the cache file header
+
+	struct Region
+	{
+		UString::String name;// Location ID string
+
+		double minLongitude = 0.0;// [deg]
+		double minLatitude = 0.0;// [deg]
+		double maxLongitude = 0.0;// [deg]
+		double maxLatitude = 0.0;// [deg]
+
+		std::vector<uint32_t> polygonStarts;// Index of first ring in each polygon; size is polygon count + 1.  First ring in each polygon is the outer boundary.
+		std::vector<uint32_t> ringStarts;// Index of first vertex in each ring; size is ring count + 1
+		std::vector<double> longitudes;// [deg]
+		std::vector<double> latitudes;// [deg]
+	};
+
+	bool Load(const uint64_t& archiveHash, std::vector<Region>& regions) const;
+	bool Save(const ArchiveInfo& archive, const std::vector<Region>& regions) const;
+
+	static bool BuildRegion(const UString::String& name, const std::string& kml, Region& region);// kml is the geometry portion of a placemark
+
+private:
+	static const uint16_t cacheVersion;
+	static const int maxFixedPointPrecision;
+
+	const UString::String fileName;
+	const int precision;
+	const bool useFixedPoint;// Vertices are stored as 32-bit integers when precision allows, otherwise as doubles
+	const double fixedPointScale;
+
+	static bool ReadHeader(std::ifstream& file, ArchiveInfo& archive, int32_t& cachePrecision);
+	bool LoadRegion(std::ifstream& file, Region& region) const;
+	bool SaveRegion(std::ofstream& file, const Region& region) const;
+
+	static bool ParseRing(const std::string& coordinates, Region& region);
+	static void ComputeBoundingBox(Region& region);
+};
+
+#endif// BOUNDARY_CACHE_H_
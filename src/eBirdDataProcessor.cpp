@@ -12,6 +12,7 @@
 #include "utilities.h"
 #include "stringUtilities.h"
 #include "kernelDensityEstimation.h"
+#include "binaryIO.h"
 
 // Standard C++ headers
 #include <fstream>
@@ -21,7 +22,10 @@
 #include <map>
 #include <chrono>
 #include <set>
+#include <unordered_set>
+#include <queue>
 #include <filesystem>
+#include <charconv>
 
 namespace fs = std::filesystem;
 
@@ -30,7 +34,37 @@ const UString::String EBirdDataProcessor::headerLine(_T("Submission ID,Common Na
 	"Protocol,Duration (Min),All Obs Reported,Distance Traveled (km),Area Covered (ha),"
 	"Number of Observers,Breeding Code,Observation Details,Checklist Comments,ML Catalog Numbers"));
 
+const UString::String EBirdDataProcessor::snapshotExtension(_T(".snapshot"));
+const uint16_t EBirdDataProcessor::snapshotVersion(2);
+
 bool EBirdDataProcessor::Parse()
+{
+	const auto dataStamp(GetSourceFileStamp(appConfig.dataFileName));
+	const auto mediaStamp(GetSourceFileStamp(appConfig.mediaFileName));
+	const UString::String snapshotFileName(appConfig.dataFileName + snapshotExtension);
+	if (dataStamp.size > 0 && ReadSnapshot(snapshotFileName, dataStamp, mediaStamp))
+	{
+		Cout << "Read " << data.size() << " entries from snapshot" << std::endl;
+		return true;
+	}
+
+	if (!ParseDataFile())
+		return false;
+
+	// Media ratings are joined here (rather than waiting for ReadMediaList()) so they can be included in the snapshot
+	if (mediaStamp.size > 0)
+		AssignMediaRatings();
+
+	if (mediaStamp.size == 0 || mediaRatingsAssigned)
+	{
+		if (!WriteSnapshot(snapshotFileName, dataStamp, mediaStamp))
+			Cerr << "Warning:  Failed to write snapshot file '" << snapshotFileName << "'\n";
+	}
+
+	return true;
+}
+
+bool EBirdDataProcessor::ParseDataFile()
 {
 	UString::IFStream file(appConfig.dataFileName.c_str());
 	if (!file.is_open() || !file.good())
@@ -70,6 +104,188 @@ bool EBirdDataProcessor::Parse()
 	return true;
 }
 
+EBirdDataProcessor::SourceFileStamp EBirdDataProcessor::GetSourceFileStamp(const UString::String& fileName)
+{
+	SourceFileStamp stamp;
+	std::error_code ec;
+	const fs::path path(fileName);
+	if (fileName.empty() || !fs::is_regular_file(path, ec))
+		return stamp;
+
+	const auto size(fs::file_size(path, ec));
+	if (ec)
+		return stamp;
+
+	const auto modificationTime(fs::last_write_time(path, ec));
+	if (ec)
+		return stamp;
+
+	stamp.size = static_cast<uint64_t>(size);
+	stamp.modificationTime = static_cast<int64_t>(modificationTime.time_since_epoch().count());
+	return stamp;
+}
+
+// Snapshot files contain the parsed data (with media ratings already assigned, if available) and the size and
+// modification time of the source files.  If the source files change, the snapshot is ignored and regenerated.
+bool EBirdDataProcessor::ReadSnapshot(const UString::String& fileName, const SourceFileStamp& dataStamp, const SourceFileStamp& mediaStamp)
+{
+	std::ifstream file(fileName.c_str(), std::ios::binary);
+	if (!file.is_open() || !file.good())
+		return false;
+
+	uint16_t version;
+	if (!BinaryIO::Read(file, version) || version != snapshotVersion)
+		return false;
+
+	SourceFileStamp snapshotDataStamp, snapshotMediaStamp;
+	if (!BinaryIO::Read(file, snapshotDataStamp.size) || !BinaryIO::Read(file, snapshotDataStamp.modificationTime) ||
+		!BinaryIO::Read(file, snapshotMediaStamp.size) || !BinaryIO::Read(file, snapshotMediaStamp.modificationTime))
+		return false;
+
+	if (snapshotDataStamp != dataStamp || snapshotMediaStamp != mediaStamp)
+		return false;
+
+	uint8_t hasMediaRatings;
+	uint32_t entryCount;
+	if (!BinaryIO::Read(file, hasMediaRatings) || !BinaryIO::ReadCount(file, sizeof(uint32_t), entryCount))// Each entry begins with a string length
+		return false;
+
+	std::vector<Entry> snapshotData(entryCount);
+	for (auto& entry : snapshotData)
+	{
+		if (!DeserializeEntry(file, entry))
+		{
+			Cerr << "Failed to read snapshot file '" << fileName << "'; re-parsing data file\n";
+			return false;
+		}
+	}
+
+	uint32_t mediaRatingsCount;
+	if (!BinaryIO::ReadCount(file, sizeof(MediaRatings::bestPhotoRating) + sizeof(MediaRatings::bestAudioRating), mediaRatingsCount))
+		return false;
+
+	std::vector<MediaRatings> snapshotMediaRatings(mediaRatingsCount);
+	for (auto& ratings : snapshotMediaRatings)
+	{
+		if (!BinaryIO::Read(file, ratings.bestPhotoRating) || !BinaryIO::Read(file, ratings.bestAudioRating))
+		{
+			Cerr << "Failed to read snapshot file '" << fileName << "'; re-parsing data file\n";
+			return false;
+		}
+	}
+
+	data = std::move(snapshotData);
+	mediaRatings = std::move(snapshotMediaRatings);
+	mediaRatingsAssigned = hasMediaRatings != 0;
+	return true;
+}
+
+bool EBirdDataProcessor::WriteSnapshot(const UString::String& fileName, const SourceFileStamp& dataStamp, const SourceFileStamp& mediaStamp) const
+{
+	std::ofstream file(fileName.c_str(), std::ios::binary);
+	if (!file.is_open() || !file.good())
+		return false;
+
+	if (!BinaryIO::Write(file, snapshotVersion) ||
+		!BinaryIO::Write(file, dataStamp.size) || !BinaryIO::Write(file, dataStamp.modificationTime) ||
+		!BinaryIO::Write(file, mediaStamp.size) || !BinaryIO::Write(file, mediaStamp.modificationTime) ||
+		!BinaryIO::Write(file, static_cast<uint8_t>(mediaRatingsAssigned)) ||
+		!BinaryIO::Write(file, static_cast<uint32_t>(data.size())))
+		return false;
+
+	for (const auto& entry : data)
+	{
+		if (!SerializeEntry(file, entry))
+			return false;
+	}
+
+	if (!BinaryIO::Write(file, static_cast<uint32_t>(mediaRatings.size())))
+		return false;
+
+	for (const auto& ratings : mediaRatings)
+	{
+		if (!BinaryIO::Write(file, ratings.bestPhotoRating) || !BinaryIO::Write(file, ratings.bestAudioRating))
+			return false;
+	}
+
+	return true;
+}
+
+bool EBirdDataProcessor::SerializeEntry(std::ofstream& file, const Entry& entry)
+{
+	return BinaryIO::WriteString(file, entry.submissionID) &&
+		BinaryIO::WriteString(file, entry.commonName) &&
+		BinaryIO::WriteString(file, entry.scientificName) &&
+		BinaryIO::Write(file, entry.taxonomicOrder) &&
+		BinaryIO::Write(file, entry.count) &&
+		BinaryIO::WriteString(file, entry.stateProvidence) &&
+		BinaryIO::WriteString(file, entry.county) &&
+		BinaryIO::WriteString(file, entry.locationID) &&
+		BinaryIO::WriteString(file, entry.location) &&
+		BinaryIO::Write(file, entry.latitude) &&
+		BinaryIO::Write(file, entry.longitude) &&
+		BinaryIO::Write(file, entry.dateTime.tm_sec) &&
+		BinaryIO::Write(file, entry.dateTime.tm_min) &&
+		BinaryIO::Write(file, entry.dateTime.tm_hour) &&
+		BinaryIO::Write(file, entry.dateTime.tm_mday) &&
+		BinaryIO::Write(file, entry.dateTime.tm_mon) &&
+		BinaryIO::Write(file, entry.dateTime.tm_year) &&
+		BinaryIO::Write(file, entry.dateTime.tm_wday) &&
+		BinaryIO::Write(file, entry.dateTime.tm_yday) &&
+		BinaryIO::Write(file, entry.dateTime.tm_isdst) &&
+		BinaryIO::WriteString(file, entry.protocol) &&
+		BinaryIO::Write(file, entry.duration) &&
+		BinaryIO::Write(file, entry.allObsReported) &&
+		BinaryIO::Write(file, entry.distanceTraveled) &&
+		BinaryIO::Write(file, entry.areaCovered) &&
+		BinaryIO::Write(file, entry.numberOfObservers) &&
+		BinaryIO::WriteString(file, entry.breedingCode) &&
+		BinaryIO::WriteString(file, entry.speciesComments) &&
+		BinaryIO::WriteString(file, entry.checklistComments) &&
+		BinaryIO::WriteString(file, entry.mlCatalogNumbers) &&
+		BinaryIO::Write(file, entry.mediaRatingsIndex);
+}
+
+bool EBirdDataProcessor::DeserializeEntry(std::ifstream& file, Entry& entry)
+{
+	entry.dateTime = std::tm();
+	if (!(BinaryIO::ReadString(file, entry.submissionID) &&
+		BinaryIO::ReadString(file, entry.commonName) &&
+		BinaryIO::ReadString(file, entry.scientificName) &&
+		BinaryIO::Read(file, entry.taxonomicOrder) &&
+		BinaryIO::Read(file, entry.count) &&
+		BinaryIO::ReadString(file, entry.stateProvidence) &&
+		BinaryIO::ReadString(file, entry.county) &&
+		BinaryIO::ReadString(file, entry.locationID) &&
+		BinaryIO::ReadString(file, entry.location) &&
+		BinaryIO::Read(file, entry.latitude) &&
+		BinaryIO::Read(file, entry.longitude) &&
+		BinaryIO::Read(file, entry.dateTime.tm_sec) &&
+		BinaryIO::Read(file, entry.dateTime.tm_min) &&
+		BinaryIO::Read(file, entry.dateTime.tm_hour) &&
+		BinaryIO::Read(file, entry.dateTime.tm_mday) &&
+		BinaryIO::Read(file, entry.dateTime.tm_mon) &&
+		BinaryIO::Read(file, entry.dateTime.tm_year) &&
+		BinaryIO::Read(file, entry.dateTime.tm_wday) &&
+		BinaryIO::Read(file, entry.dateTime.tm_yday) &&
+		BinaryIO::Read(file, entry.dateTime.tm_isdst) &&
+		BinaryIO::ReadString(file, entry.protocol) &&
+		BinaryIO::Read(file, entry.duration) &&
+		BinaryIO::Read(file, entry.allObsReported) &&
+		BinaryIO::Read(file, entry.distanceTraveled) &&
+		BinaryIO::Read(file, entry.areaCovered) &&
+		BinaryIO::Read(file, entry.numberOfObservers) &&
+		BinaryIO::ReadString(file, entry.breedingCode) &&
+		BinaryIO::ReadString(file, entry.speciesComments) &&
+		BinaryIO::ReadString(file, entry.checklistComments) &&
+		BinaryIO::ReadString(file, entry.mlCatalogNumbers) &&
+		BinaryIO::Read(file, entry.mediaRatingsIndex)))
+		return false;
+
+	entry.compareString = PrepareForComparison(entry.commonName);
+	return true;
+}
+
 bool EBirdDataProcessor::ParseLine(const UString::String& line, Entry& entry)
 {
 	UString::IStringStream lineStream(line);
@@ -336,14 +552,18 @@ void EBirdDataProcessor::SortData(const EBDPConfig::SortBy& primarySort, const E
 }
 
 std::vector<EBirdDataProcessor::Entry> EBirdDataProcessor::RemoveHighMediaScores(
-	const int& minPhotoScore, const int& minAudioScore, const std::vector<Entry>& data)
+	const int& minPhotoScore, const int& minAudioScore, const std::vector<Entry>& data) const
 {
 	std::vector<Entry> sublist(data);
 	std::set<UString::String> haveMediaSet;
-	std::for_each(sublist.begin(), sublist.end(), [&minPhotoScore, &minAudioScore, &haveMediaSet](const Entry& entry)
+	std::for_each(sublist.begin(), sublist.end(), [this, &minPhotoScore, &minAudioScore, &haveMediaSet](const Entry& entry)
 	{
-		if ((!entry.photoRating.empty() && *std::max_element(entry.photoRating.begin(), entry.photoRating.end()) >= minPhotoScore && minPhotoScore >= 0) ||
-			(!entry.audioRating.empty() && *std::max_element(entry.audioRating.begin(), entry.audioRating.end()) >= minAudioScore && minAudioScore >= 0))
+		if (entry.mediaRatingsIndex == noMediaRatings)
+			return;
+
+		const auto& ratings(mediaRatings[entry.mediaRatingsIndex]);
+		if ((ratings.bestPhotoRating != MediaRatings::noRating && ratings.bestPhotoRating >= minPhotoScore && minPhotoScore >= 0) ||
+			(ratings.bestAudioRating != MediaRatings::noRating && ratings.bestAudioRating >= minAudioScore && minAudioScore >= 0))
 			haveMediaSet.insert(entry.compareString);
 	});
 	sublist.erase(std::remove_if(sublist.begin(), sublist.end(), [&haveMediaSet](const Entry& entry)
@@ -404,10 +624,14 @@ UString::String EBirdDataProcessor::GenerateList(const EBDPConfig::ListType& typ
 		ss << count++ << ", " << std::put_time(&entry.dateTime, _T("%D")) << ", "
 			<< entry.commonName << ", '" << entry.location << "', " << entry.count;
 
-		if (!entry.photoRating.empty())
-			ss << " (photo rating = " << *std::max_element(entry.photoRating.begin(), entry.photoRating.end()) << ')';
-		if (!entry.audioRating.empty())
-			ss << " (audio rating = " << *std::max_element(entry.audioRating.begin(), entry.audioRating.end()) << ')';
+		if (entry.mediaRatingsIndex != noMediaRatings)
+		{
+			const auto& ratings(mediaRatings[entry.mediaRatingsIndex]);
+			if (ratings.bestPhotoRating != MediaRatings::noRating)
+				ss << " (photo rating = " << ratings.bestPhotoRating << ')';
+			if (ratings.bestAudioRating != MediaRatings::noRating)
+				ss << " (audio rating = " << ratings.bestAudioRating << ')';
+		}
 
 		ss << '\n';
 	}
@@ -1395,6 +1619,11 @@ bool EBirdDataProcessor::GenerateMediaList(const UString::String& mediaListHTML)
 	return true;
 }
 
+UString::String EBirdDataProcessor::BuildMediaKey(const UString::String& checklistID, const UString::String& compareString)
+{
+	return checklistID + UString::Char('|') + compareString;
+}
+
 bool EBirdDataProcessor::ParseMediaEntry(const UString::String& line, MediaEntry& entry)
 {
 	UString::IStringStream lineStream(line);
@@ -1452,6 +1681,14 @@ bool EBirdDataProcessor::ParseMediaEntry(const UString::String& line, MediaEntry
 }
 
 bool EBirdDataProcessor::ReadMediaList()
+{
+	if (mediaRatingsAssigned)// Already done while parsing data file or from snapshot
+		return true;
+
+	return AssignMediaRatings();
+}
+
+bool EBirdDataProcessor::AssignMediaRatings()
 {
 	UString::IFStream mediaFile(appConfig.mediaFileName.c_str());
 	if (!mediaFile.is_open() || !mediaFile.good())
@@ -1476,22 +1713,33 @@ bool EBirdDataProcessor::ReadMediaList()
 		mediaList.push_back(entry);
 	}
 
+	// Index the media by checklist and species, then look up each observation in a single pass
+	std::unordered_map<UString::String, uint32_t> mediaRatingsIndices;
+	mediaRatings.clear();
+	for (const auto& m : mediaList)
+	{
+		const auto insertion(mediaRatingsIndices.emplace(BuildMediaKey(m.checklistId, PrepareForComparison(m.commonName)),
+			static_cast<uint32_t>(mediaRatings.size())));
+		if (insertion.second)
+			mediaRatings.push_back(MediaRatings());
+
+		auto& ratings(mediaRatings[insertion.first->second]);
+		if (m.type == MediaEntry::Type::Photo)
+			ratings.bestPhotoRating = std::max(ratings.bestPhotoRating, m.rating);
+		else// if (m.type == MediaEntry::Type::Audio)
+			ratings.bestAudioRating = std::max(ratings.bestAudioRating, m.rating);
+	}
+
 	for (auto& entry : data)
 	{
-		for (auto& m : mediaList)
-		{
-			if (m.checklistId.compare(entry.submissionID) == 0 &&
-				CommonNamesMatch(entry.commonName, m.commonName))
-			{
-				if (m.type == MediaEntry::Type::Photo)
-					entry.photoRating.push_back(m.rating);
-				else// if (m.type == MediaEntry::Type::Audio)
-					entry.audioRating.push_back(m.rating);
-				//break;// Efficiency gain if we break, but if an entry has both audio and photo media, only one of them will be assigned.  In practice, efficiency gain here is not needed.
-			}
-		}
+		const auto it(mediaRatingsIndices.find(BuildMediaKey(entry.submissionID, entry.compareString)));
+		if (it == mediaRatingsIndices.end())
+			entry.mediaRatingsIndex = noMediaRatings;
+		else
+			entry.mediaRatingsIndex = it->second;
 	}
 
+	mediaRatingsAssigned = true;
 	return true;
 }
 
@@ -1871,62 +2119,92 @@ void EBirdDataProcessor::DoListComparison() const
 		years.insert(e.dateTime.tm_year + 1900);
 	Cout << "Data for selected location spans " << years.size() << " years\n" << std::endl;
 
-	std::vector<std::vector<Entry>> yearLists(years.size());
+	std::vector<ComparisonList> lists(years.size());
+	std::unordered_map<unsigned int, unsigned int> listIndices;// Maps year to index into lists
+	for (const auto& y : years)
+	{
+		const auto i(static_cast<unsigned int>(listIndices.size()));
+		UString::OStringStream ss;
+		ss << y;
+		lists[i].heading = ss.str();
+		listIndices[y] = i;
+	}
 
-	auto it(years.begin());
-	for (unsigned int i = 0; i < years.size(); ++i)
+	std::vector<ComparisonSpecies> species;
+	std::unordered_map<UString::String, unsigned int> speciesIDs;// Maps compare string to index into species
+	for (const auto& e : data)
 	{
-		auto temp(data);
-		FilterYear(*it, temp);
-		++it;
-		yearLists[i] = ConsolidateByYear(temp);
+		const auto insertion(speciesIDs.emplace(e.compareString, static_cast<unsigned int>(species.size())));
+		if (insertion.second)
+			species.push_back({ e.commonName, e.taxonomicOrder });
+		else if (e.taxonomicOrder < species[insertion.first->second].taxonomicOrder)
+			species[insertion.first->second].taxonomicOrder = e.taxonomicOrder;
+
+		lists[listIndices[e.dateTime.tm_year + 1900]].speciesIDs.push_back(insertion.first->second);
 	}
 
-	std::sort(yearLists.begin(), yearLists.end(), [](const std::vector<Entry>& a, const std::vector<Entry>& b)
+	auto taxonomicComparison([&species](const unsigned int& a, const unsigned int& b)
 	{
-		return a.front().dateTime.tm_year < b.front().dateTime.tm_year;
+		if (species[a].taxonomicOrder == species[b].taxonomicOrder)
+			return a < b;
+		return species[a].taxonomicOrder < species[b].taxonomicOrder;
 	});
+
+	for (auto& l : lists)
+	{
+		std::sort(l.speciesIDs.begin(), l.speciesIDs.end(), taxonomicComparison);
+		l.speciesIDs.erase(std::unique(l.speciesIDs.begin(), l.speciesIDs.end()), l.speciesIDs.end());
+	}
 	
-	PrintListComparison(yearLists);
+	PrintListComparison(lists, species);
 }
 
-void EBirdDataProcessor::PrintListComparison(const std::vector<std::vector<Entry>>& lists)
+// Lists must be sorted using the same ordering used for the heap (taxonomic order, then species ID) and contain no duplicates
+void EBirdDataProcessor::PrintListComparison(const std::vector<ComparisonList>& lists, const std::vector<ComparisonSpecies>& species)
 {
-	std::vector<unsigned int> indexList(lists.size(), 0);
 	std::vector<std::vector<UString::String>> listData(lists.size() + 1);// first index is column, second is row
 
 	listData.front().push_back(_T("Species"));
+	for (unsigned int i = 0; i < lists.size(); ++i)
+		listData[i + 1].push_back(lists[i].heading);
+
+	typedef std::pair<unsigned int, unsigned int> Cursor;// first is list index, second is position within list
+	auto cursorComparison([&lists, &species](const Cursor& a, const Cursor& b)
+	{
+		const auto idA(lists[a.first].speciesIDs[a.second]);
+		const auto idB(lists[b.first].speciesIDs[b.second]);
+		if (species[idA].taxonomicOrder != species[idB].taxonomicOrder)
+			return species[idA].taxonomicOrder > species[idB].taxonomicOrder;
+		return idA > idB;
+	});
+
+	// Top of the heap is always the next species (across all lists) to be added to the table
+	std::priority_queue<Cursor, std::vector<Cursor>, decltype(cursorComparison)> heap(cursorComparison);
 	for (unsigned int i = 0; i < lists.size(); ++i)
 	{
-		UString::OStringStream ss;
-		ss << lists[i].front().dateTime.tm_year + 1900;
-		listData[i + 1].push_back(ss.str());
+		if (!lists[i].speciesIDs.empty())
+			heap.push(Cursor(i, 0));
 	}
 
-	while (IndicesAreValid(indexList, lists))
+	std::vector<bool> present(lists.size());
+	while (!heap.empty())
 	{
-		double minTaxonomicOrder(std::numeric_limits<double>::max());
-		unsigned int minIndex(0);
-		UString::String compareString;
-		for (unsigned int i = 0; i < lists.size(); ++i)
+		const auto id(lists[heap.top().first].speciesIDs[heap.top().second]);
+		std::fill(present.begin(), present.end(), false);
+		while (!heap.empty() && lists[heap.top().first].speciesIDs[heap.top().second] == id)
 		{
-			if (indexList[i] < lists[i].size() && lists[i][indexList[i]].taxonomicOrder < minTaxonomicOrder)
-			{
-				minTaxonomicOrder = lists[i][indexList[i]].taxonomicOrder;
-				minIndex = i;
-				compareString = lists[i][indexList[i]].compareString;
-			}
+			auto cursor(heap.top());
+			heap.pop();
+			present[cursor.first] = true;
+			if (++cursor.second < lists[cursor.first].speciesIDs.size())
+				heap.push(cursor);
 		}
 
-		listData[0].push_back(lists[minIndex][indexList[minIndex]].commonName);
+		listData[0].push_back(species[id].commonName);
 		for (unsigned int i = 0; i < lists.size(); ++i)
 		{
-			if (indexList[i] < lists[i].size() &&
-				lists[i][indexList[i]].compareString.compare(compareString) == 0)
-			{
+			if (present[i])
 				listData[i + 1].push_back(_T("X"));
-				++indexList[i];
-			}
 			else
 				listData[i + 1].push_back(UString::String());
 		}
@@ -1939,25 +2217,13 @@ void EBirdDataProcessor::PrintListComparison(const std::vector<std::vector<Entry
 	for (unsigned int i = 0; i < lists.size(); ++i)
 	{
 		UString::OStringStream ss;
-		ss << lists[i].size();
+		ss << lists[i].speciesIDs.size();
 		listData[i + 1].push_back(ss.str());
 	}
 
 	Cout << PrintInColumns(listData, 2) << std::endl;
 }
 
-bool EBirdDataProcessor::IndicesAreValid(const std::vector<unsigned int>& indices, const std::vector<std::vector<Entry>>& lists)
-{
-	assert(indices.size() == lists.size());
-	for (unsigned int i = 0; i < indices.size(); ++i)
-	{
-		if (indices[i] < lists[i].size())
-			return true;
-	}
-
-	return false;
-}
-
 UString::String EBirdDataProcessor::PrintInColumns(const std::vector<std::vector<UString::String>>& cells, const unsigned int& columnSpacing)
 {
 	std::vector<size_t> widths(cells.size(), 0);
@@ -2503,14 +2769,13 @@ void EBirdDataProcessor::BuildJSData(const UString::String& fileName) const
 		UString::String compareString;
 		unsigned int order;
 		UString::String firstObservedDate;
-		
-		bool operator==(const UString::String& test) { return test == compareString; }
 	};
 	
 	std::vector<SpeciesOrder> species;
+	std::unordered_set<UString::String> speciesFound;
 	for (const auto& o : data)
 	{
-		if (std::find(species.begin(), species.end(), o.compareString) != species.end())
+		if (!speciesFound.insert(o.compareString).second)
 			continue;
 			
 		SpeciesOrder so;
@@ -2528,13 +2793,14 @@ void EBirdDataProcessor::BuildJSData(const UString::String& fileName) const
 	{
 		return a.order < b.order;
 	});
-		
+
+	const auto frequencyIndex(BuildWeeklyFrequencyIndex());
 	for (const auto& s : species)
 	{
 		cJSON* item(cJSON_CreateObject());
 		cJSON_AddItemToObject(item, "species", cJSON_CreateString(UString::ToNarrowString(s.compareString).c_str()));// Use compare string to ensure we don't include subspecies info
 		cJSON_AddItemToObject(item, "firstObservedDate", cJSON_CreateString(UString::ToNarrowString(s.firstObservedDate).c_str()));
-		const auto frequency(ComputeFrequency(s.compareString));
+		const auto frequency(ComputeFrequency(frequencyIndex, s.compareString));
 		cJSON_AddItemToObject(item, "frequency", cJSON_CreateDoubleArray(frequency.data(), static_cast<int>(frequency.size())));
 		
 		cJSON_AddItemToArray(root, item);
@@ -2545,34 +2811,42 @@ void EBirdDataProcessor::BuildJSData(const UString::String& fileName) const
 	 
 	cJSON_free(root);
 }
- 
-std::array<double, 48> EBirdDataProcessor::ComputeFrequency(const UString::String& compareString) const
+
+// Single pass over the data to count complete checklists and species hits for each week.
+// Once built, frequency for any species can be computed without re-scanning the data.
+EBirdDataProcessor::WeeklyFrequencyIndex EBirdDataProcessor::BuildWeeklyFrequencyIndex() const
 {
-	std::array<std::set<UString::String>, 48> checklists = {};
-	std::array<int, 48> hits = {};
+	WeeklyFrequencyIndex index;
+	std::unordered_set<UString::String> completeChecklists;// Each checklist falls within exactly one week
 	
 	for (const auto& o : data)
 	{
 		const auto i(GetWeekIndex(o.dateTime));
-		if (o.allObsReported)
-			checklists[i].insert(o.submissionID);
-		
-		if (o.compareString == compareString)
-		{
-			if (!o.allObsReported && hits[i] == 0)
-				hits[i] = -1;
-			else if (o.allObsReported && hits[i] == -1)
-				hits[i] = 1;
-			else if (o.allObsReported)
-				++hits[i];
-		}
+		if (o.allObsReported && completeChecklists.insert(o.submissionID).second)
+			++index.checklistCounts[i];
+
+		auto& hits(index.speciesHits.emplace(o.compareString, std::array<int, 48>()).first->second);
+		if (!o.allObsReported && hits[i] == 0)
+			hits[i] = -1;
+		else if (o.allObsReported && hits[i] == -1)
+			hits[i] = 1;
+		else if (o.allObsReported)
+			++hits[i];
 	}
-	
+
+	return index;
+}
+ 
+std::array<double, 48> EBirdDataProcessor::ComputeFrequency(const WeeklyFrequencyIndex& index, const UString::String& compareString)
+{
+	const auto it(index.speciesHits.find(compareString));
+	const std::array<int, 48> hits(it == index.speciesHits.end() ? std::array<int, 48>() : it->second);
+
 	std::array<double, 48> frequency;
 	for (unsigned int i = 0; i < frequency.size(); ++i)
 	{
 		if (hits[i] >= 0)
-			frequency[i] = static_cast<double>(hits[i]) / checklists[i].size();
+			frequency[i] = static_cast<double>(hits[i]) / index.checklistCounts[i];
 		else
 			frequency[i] = -1;
 	}
@@ -2595,50 +2869,27 @@ unsigned int EBirdDataProcessor::GetWeekIndex(const std::tm& date)
 
 bool EBirdDataProcessor::GenerateBirdingSpotBubbleData(const UString::String& fileName) const
 {
-	cJSON* root(cJSON_CreateArray());
-
 	struct LocationData
 	{
-		UString::String locationID;
 		double latitude;
 		double longitude;
-		std::set<UString::String> observationEventIDs;
+		std::vector<uint64_t> observationEventIDs;
 	};
 
 	std::vector<LocationData> locations;
+	std::unordered_map<UString::String, std::size_t> locationIndices;// Maps location ID to index in locations
 	for (const auto& o : data)
 	{
-		bool found(false);
-		for (auto& location : locations)
+		const auto insertion(locationIndices.emplace(o.locationID, locations.size()));
+		if (insertion.second)
 		{
-			if (location.locationID == o.locationID)
-			{
-				location.observationEventIDs.insert(o.submissionID);
-				found = true;
-				break;
-			}
+			LocationData newLocation;
+			newLocation.latitude = o.latitude;
+			newLocation.longitude = o.longitude;
+			locations.push_back(newLocation);
 		}
 
-		if (found)
-			continue;
-
-		LocationData newLocation;
-		newLocation.locationID = o.locationID;
-		newLocation.observationEventIDs.insert(o.submissionID);
-		newLocation.latitude = o.latitude;
-		newLocation.longitude = o.longitude;
-
-		locations.push_back(newLocation);
-	}
-
-	for (const auto& l : locations)
-	{
-		cJSON* item(cJSON_CreateObject());
-		cJSON_AddItemToObject(item, "latitude", cJSON_CreateNumber(l.latitude));
-		cJSON_AddItemToObject(item, "longitude", cJSON_CreateNumber(l.longitude));
-		cJSON_AddItemToObject(item, "count", cJSON_CreateNumber(static_cast<double>(l.observationEventIDs.size())));
-
-		cJSON_AddItemToArray(root, item);
+		locations[insertion.first->second].observationEventIDs.push_back(GetChecklistNumber(o.submissionID));
 	}
 
 	UString::OFStream file(fileName);
@@ -2647,9 +2898,38 @@ bool EBirdDataProcessor::GenerateBirdingSpotBubbleData(const UString::String& fi
 		Cerr << "Failed to open '" << fileName << "' for output\n";
 		return false;
 	}
-	file << "var observationLocations = " << cJSON_PrintUnformatted(root) << ";\n";
 
-	cJSON_free(root);
+	// Shortest representation which recovers the same value (matches the precision of the cJSON output this replaced)
+	const auto formatCoordinate([](const double& value)
+	{
+		char s[32];
+		const auto result(std::to_chars(s, s + sizeof(s), value));
+		return UString::ToStringType(std::string(s, result.ptr));
+	});
+
+	file << "var observationLocations = [";
+	for (auto& l : locations)
+	{
+		std::sort(l.observationEventIDs.begin(), l.observationEventIDs.end());
+		const auto count(std::unique(l.observationEventIDs.begin(), l.observationEventIDs.end()) - l.observationEventIDs.begin());
+
+		if (&l != &locations.front())
+			file << ',';
+		file << "{\"latitude\":" << formatCoordinate(l.latitude) << ",\"longitude\":" << formatCoordinate(l.longitude) << ",\"count\":" << count << '}';
+	}
+	file << "];\n";
 
 	return true;
 }
+
+// Submission IDs are of the form S12345678 - this returns the numeric portion
+uint64_t EBirdDataProcessor::GetChecklistNumber(const UString::String& submissionID)
+{
+	uint64_t number(0);
+	for (const auto& c : submissionID)
+	{
+		if (c >= UString::Char('0') && c <= UString::Char('9'))
+			number = number * 10 + static_cast<uint64_t>(c - UString::Char('0'));
+	}
+	return number;
+}
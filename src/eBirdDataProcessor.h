@@ -17,12 +17,15 @@
 #include <vector>
 #include <ctime>
 #include <sstream>
+#include <fstream>
 #include <array>
 #include <algorithm>
 #include <set>
+#include <unordered_map>
 #include <utility>
 #include <cassert>
 #include <numeric>
+#include <limits>
 
 // Local forward declarations
 class FrequencyFileReader;
@@ -145,8 +148,7 @@ private:
 		UString::String checklistComments;
 		UString::String mlCatalogNumbers;
 
-		std::vector<int> photoRating;
-		std::vector<int> audioRating;
+		uint32_t mediaRatingsIndex = noMediaRatings;// Index into mediaRatings
 
 		UString::String compareString;// Huge boost in efficiency if we pre-compute this
 	};
@@ -155,6 +157,17 @@ private:
 
 	std::vector<Entry> data;
 
+	struct MediaRatings
+	{
+		static constexpr int noRating = -1;
+
+		int bestPhotoRating = noRating;
+		int bestAudioRating = noRating;
+	};
+
+	static constexpr uint32_t noMediaRatings = std::numeric_limits<uint32_t>::max();
+	std::vector<MediaRatings> mediaRatings;// Shared by all entries for the same species on the same checklist
+
 	void FilterYear(const unsigned int& year, std::vector<Entry>& dataToFilter) const;
 
 	static std::vector<Entry> ConsolidateByLife(const std::vector<Entry>& data);
@@ -162,11 +175,33 @@ private:
 	static std::vector<Entry> ConsolidateByMonth(const std::vector<Entry>& data);
 	static std::vector<Entry> ConsolidateByWeek(const std::vector<Entry>& data);
 	static std::vector<Entry> ConsolidateByDay(const std::vector<Entry>& data);
-	static std::vector<Entry> RemoveHighMediaScores(const int& minPhotoScore, const int& minAudioScore, const std::vector<Entry>& data);
+	std::vector<Entry> RemoveHighMediaScores(const int& minPhotoScore, const int& minAudioScore, const std::vector<Entry>& data) const;
 
 	static std::vector<Entry> DoConsolidation(const EBDPConfig::ListType& type, const std::vector<Entry>& data);
 
 	static bool ParseLine(const UString::String& line, Entry& entry);
+	bool ParseDataFile();
+	bool AssignMediaRatings();
+
+	bool mediaRatingsAssigned = false;
+
+	static const UString::String snapshotExtension;
+	static const uint16_t snapshotVersion;
+
+	struct SourceFileStamp
+	{
+		uint64_t size = 0;
+		int64_t modificationTime = 0;
+
+		bool operator==(const SourceFileStamp& s) const { return size == s.size && modificationTime == s.modificationTime; }
+		bool operator!=(const SourceFileStamp& s) const { return !(*this == s); }
+	};
+
+	static SourceFileStamp GetSourceFileStamp(const UString::String& fileName);
+	bool ReadSnapshot(const UString::String& fileName, const SourceFileStamp& dataStamp, const SourceFileStamp& mediaStamp);
+	bool WriteSnapshot(const UString::String& fileName, const SourceFileStamp& dataStamp, const SourceFileStamp& mediaStamp) const;
+	static bool SerializeEntry(std::ofstream& file, const Entry& entry);
+	static bool DeserializeEntry(std::ifstream& file, Entry& entry);
 
 	static int DoComparison(const Entry& a, const Entry& b, const EBDPConfig::SortBy& sortBy);
 
@@ -245,8 +280,19 @@ private:
 	static void RemoveHighLevelFiles(std::vector<UString::String>& fileNames);
 	static UString::String RemoveTrailingDash(const UString::String& s);
 
-	static void PrintListComparison(const std::vector<std::vector<Entry>>& lists);
-	static bool IndicesAreValid(const std::vector<unsigned int>& indices, const std::vector<std::vector<Entry>>& lists);
+	struct ComparisonSpecies
+	{
+		UString::String commonName;
+		unsigned int taxonomicOrder;
+	};
+
+	struct ComparisonList
+	{
+		UString::String heading;
+		std::vector<unsigned int> speciesIDs;// Indices into ComparisonSpecies vector
+	};
+
+	static void PrintListComparison(const std::vector<ComparisonList>& lists, const std::vector<ComparisonSpecies>& species);
 	static UString::String PrintInColumns(const std::vector<std::vector<UString::String>>& cells, const unsigned int& columnSpacing);
 
 	struct MediaEntry
@@ -308,6 +354,7 @@ private:
 	static UString::String GetMediaSexString(const MediaEntry::Sex& sex);
 	static UString::String GetMediaSoundString(const MediaEntry::Sound& sound);
 	static bool ParseMediaEntry(const UString::String& line, MediaEntry& entry);
+	static UString::String BuildMediaKey(const UString::String& checklistID, const UString::String& compareString);
 	static bool ExtractBetweenTagAfterTag(const UString::String& html, const UString::String& firstTag, const UString::String& secondTag, UString::String& value);
 
 	struct ConsolidationData
@@ -329,9 +376,17 @@ private:
 
 	static unsigned int CountConsecutiveLeadingQuotes(UString::IStringStream& ss);
 	
-	std::array<double, 48> ComputeFrequency(const UString::String& compareString) const;
+	struct WeeklyFrequencyIndex
+	{
+		UIntYear checklistCounts = {};// Number of unique complete checklists in each week
+		std::unordered_map<UString::String, std::array<int, 48>> speciesHits;// Key is compare string; -1 indicates species was only reported on incomplete checklists
+	};
+
+	WeeklyFrequencyIndex BuildWeeklyFrequencyIndex() const;
+	static std::array<double, 48> ComputeFrequency(const WeeklyFrequencyIndex& index, const UString::String& compareString);
 	
 	static unsigned int GetWeekIndex(const std::tm& date);
+	static uint64_t GetChecklistNumber(const UString::String& submissionID);
 };
 
 template<typename T>
@@ -30,6 +30,7 @@
 #include <filesystem>
 
 const UString::String EBirdDatasetInterface::nameIndexFileName(_T("nameIndexMap.csv"));
+const std::vector<EBirdDatasetInterface::Observation>::size_type EBirdDatasetInterface::kmlFilterBatchSize(4096);
 
 const unsigned int EBirdDatasetInterface::SpeciesData::Rarity::yearsToCheck(5);
 const unsigned int EBirdDatasetInterface::SpeciesData::Rarity::minHitYears(4);// To not be considered a rarity
@@ -1353,7 +1354,13 @@ bool EBirdDatasetInterface::ExtractObservationsWithinGeometry(
 	kmlFilterGeometry = KMLLibraryManager::ReadKML(kmlFileName); 
 	if (!kmlFilterGeometry)
 		return false;
-	return DoDatasetParsing(globalFileName, &EBirdDatasetInterface::ProcessObservationKMLFilter, outputFileName);
+	kmlFilterPreparedGeometry = std::make_unique<PreparedGeometry>(*kmlFilterGeometry);
+	if (!DoDatasetParsing(globalFileName, &EBirdDatasetInterface::ProcessObservationKMLFilter, outputFileName))
+		return false;
+
+	ProcessKMLFilterBatch(kmlFilterBatch);
+	kmlFilterBatch.clear();
+	return true;
 }
 
 std::vector<EBirdDatasetInterface::MapInfo> EBirdDatasetInterface::GetMapInfo() const
@@ -1411,14 +1418,45 @@ void EBirdDatasetInterface::AddObservationToMapInfo(const Observation& o, MapInf
 	m.checklists.back().dateString = ss.str();
 }
 
+// Most observations fall outside of the bounding box and are rejected immediately.  The rest are
+// classified in batches by whichever thread happens to fill the batch.
 void EBirdDatasetInterface::ProcessObservationKMLFilter(const Observation& observation)
 {
 	KMLLibraryManager::GeometryInfo::Point p(observation.longitude, observation.latitude);
-	if (!KMLLibraryManager::PointIsWithinPolygons(p, *kmlFilterGeometry))
+	if (!kmlFilterPreparedGeometry->IsWithinBounds(p))
 		return;
 
+	std::vector<Observation> batch;
+	{
+		std::lock_guard<std::mutex> lock(kmlFilterBatchMutex);
+		kmlFilterBatch.push_back(observation);
+		if (kmlFilterBatch.size() < kmlFilterBatchSize)
+			return;
+		batch.swap(kmlFilterBatch);
+	}
+
+	ProcessKMLFilterBatch(batch);
+}
+
+void EBirdDatasetInterface::ProcessKMLFilterBatch(const std::vector<Observation>& batch)
+{
+	std::vector<double> longitudes(batch.size());
+	std::vector<double> latitudes(batch.size());
+	for (std::vector<Observation>::size_type i = 0; i < batch.size(); ++i)
+	{
+		longitudes[i] = batch[i].longitude;
+		latitudes[i] = batch[i].latitude;
+	}
+
+	std::vector<uint8_t> inside;
+	kmlFilterPreparedGeometry->ContainsPoints(longitudes, latitudes, inside);
+
 	std::lock_guard<std::mutex> lock(mutex);
-	allObservationsInRegion[observation.uniqueID] = observation;// Don't use the checklist ID as the key for this case, or we'll end up with only one entry per checklist
+	for (std::vector<Observation>::size_type i = 0; i < batch.size(); ++i)
+	{
+		if (inside[i])
+			allObservationsInRegion[batch[i].uniqueID] = batch[i];// Don't use the checklist ID as the key for this case, or we'll end up with only one entry per checklist
+	}
 }
 
 bool EBirdDatasetInterface::ExtractSpeciesWithinTimePeriod(const unsigned int& startMonth, const unsigned int& startDay,
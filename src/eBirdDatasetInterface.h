@@ -12,6 +12,7 @@
 #include "eBirdInterface.h"
 #include "eBirdDataProcessor.h"
 #include "kmlLibraryManager.h"
+#include "preparedGeometry.h"
 
 // Standard C++ headers
 #include <unordered_map>
@@ -167,10 +168,15 @@ private:
 	bool RegionMatches(const UString::String& regionCode) const;
 
 	std::unique_ptr<KMLLibraryManager::GeometryInfo> kmlFilterGeometry;
+	std::unique_ptr<PreparedGeometry> kmlFilterPreparedGeometry;
+	static const std::vector<Observation>::size_type kmlFilterBatchSize;
+	std::vector<Observation> kmlFilterBatch;// Observations within bounding box of kmlFilterGeometry, awaiting classification
+	std::mutex kmlFilterBatchMutex;
 	
 	void ProcessObservationDataFrequency(const Observation& observation);
 	void ProcessObservationDataTimeOfDay(const Observation& observation);
 	void ProcessObservationKMLFilter(const Observation& observation);
+	void ProcessKMLFilterBatch(const std::vector<Observation>& batch);
 	typedef void (EBirdDatasetInterface::*ProcessFunction)(const Observation& observation);
 	void UpdateRarityAssessment();
 	void RemoveRarities();
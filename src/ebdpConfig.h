@@ -45,6 +45,10 @@ struct LocationFindingParameters
 	bool cleanupKMLLocationNames;
 	double kmlReductionLimit;
 	int geoJSONPrecision;
+	unsigned int kmlPreloadMemoryLimit;// [MB]
+	unsigned int kmlCacheMemoryLimit;// [MB]
+	int vectorTileMaxZoom;// Negative to embed region geometry in the page instead of writing vector tiles
+	bool binaryWeekData;// Smaller, but the page must be served over HTTP (otherwise week data is included in the page data)
 	UString::String baseOutputFileName;
 };
 
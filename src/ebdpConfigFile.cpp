@@ -63,6 +63,10 @@ void EBDPConfigFile::BuildConfigItems()
 	AddConfigItem(_T("CLEANUP_KML_NAMES"), config.locationFindingParameters.cleanupKMLLocationNames);
 	AddConfigItem(_T("KML_REDUCTION_LIMIT"), config.locationFindingParameters.kmlReductionLimit);
 	AddConfigItem(_T("GEO_JSON_PRECISION"), config.locationFindingParameters.geoJSONPrecision);
+	AddConfigItem(_T("KML_PRELOAD_MEMORY_LIMIT"), config.locationFindingParameters.kmlPreloadMemoryLimit);
+	AddConfigItem(_T("KML_CACHE_MEMORY_LIMIT"), config.locationFindingParameters.kmlCacheMemoryLimit);
+	AddConfigItem(_T("VECTOR_TILE_MAX_ZOOM"), config.locationFindingParameters.vectorTileMaxZoom);
+	AddConfigItem(_T("BINARY_WEEK_DATA"), config.locationFindingParameters.binaryWeekData);
 	AddConfigItem(_T("OUTPUT_BASE_FILE_NAME"), config.locationFindingParameters.baseOutputFileName);
 
 	AddConfigItem(_T("BUBBLE_DATA_FILE_NAME"), config.birdingSpotBubbleDataFileName);
@@ -134,6 +138,10 @@ void EBDPConfigFile::AssignDefaults()
 	config.locationFindingParameters.kmlReductionLimit = 0.0;
 	config.locationFindingParameters.cleanupKMLLocationNames = false;
 	config.locationFindingParameters.geoJSONPrecision = -1;
+	config.locationFindingParameters.kmlPreloadMemoryLimit = 0;
+	config.locationFindingParameters.kmlCacheMemoryLimit = 0;
+	config.locationFindingParameters.vectorTileMaxZoom = -1;
+	config.locationFindingParameters.binaryWeekData = false;
 	config.locationFindingParameters.baseOutputFileName = _T("bestLocations");
 
 	config.bigYear.clear();
@@ -297,6 +305,12 @@ bool EBDPConfigFile::FindMaxNeedsConfigIsOK()
 		configurationOK = false;
 	}
 
+	if (config.locationFindingParameters.vectorTileMaxZoom > 12)
+	{
+		Cerr << GetKey(config.locationFindingParameters.vectorTileMaxZoom) << " must not be greater than 12 (the map scales the highest zoom tiles for closer views)\n";
+		configurationOK = false;
+	}
+
 	for (const auto& c : config.highDetailCountries)
 	{
 		if (c.length() != 2)
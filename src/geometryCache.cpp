@@ -0,0 +1,160 @@
+// File:  geometryCache.cpp
+// Date:  10/18/2026
+// Auth:  K. Loux
+// Desc:  Binary cache of converted (parsed and reduced) region geometry, shared by the map generators.
+
+// Local headers
+#include "geometryCache.h"
+#include "binaryIO.h"
+
+// Standard C++ headers
+#include <filesystem>
+#include <sstream>
+#include <iomanip>
+#include <cctype>
+
+const UString::String GeometryCache::fileExtension(_T(".geometry"));
+const uint16_t GeometryCache::cacheVersion(1);
+const std::string::size_type GeometryCache::maxNameLength(32);
+
+GeometryCache::GeometryCache(const UString::String& directory) : directory(directory)
+{
+}
+
+// File names start with the (sanitized) region, so entries can be identified by eye.  The hash covers
+// the reduction limits and precision, too, so consumers with different settings keep separate entries.
+UString::String GeometryCache::GetFileName(const Key& key) const
+{
+	uint64_t hash(BinaryIO::ComputeHash(key.region));
+	hash = BinaryIO::ComputeHash(reinterpret_cast<const char*>(key.reductionLimits.data()), key.reductionLimits.size() * sizeof(double), hash);
+	const int32_t precision(key.precision);
+	hash = BinaryIO::ComputeHash(reinterpret_cast<const char*>(&precision), sizeof(precision), hash);
+
+	std::ostringstream ss;
+	for (const auto& c : key.region.substr(0, maxNameLength))
+	{
+		if (std::isalnum(static_cast<unsigned char>(c)) || c == '-' || c == '_')
+			ss << c;
+		else
+			ss << '_';
+	}
+	ss << '_' << std::hex << std::setw(16) << std::setfill('0') << hash;
+
+	const std::filesystem::path path(std::filesystem::path(directory) / (ss.str() + UString::ToNarrowString(fileExtension)));
+	return UString::ToStringType(path.string());
+}
+
+bool GeometryCache::OpenForRead(const Key& key, std::ifstream& file) const
+{
+	file.open(GetFileName(key).c_str(), std::ios::binary);
+	if (!file.is_open() || !file.good())
+		return false;
+
+	uint16_t version;
+	std::string region;
+	std::vector<double> reductionLimits;
+	int32_t precision;
+	uint64_t sourceHash;
+	return BinaryIO::Read(file, version) && version == cacheVersion &&
+		BinaryIO::ReadString(file, region) && region == key.region &&
+		BinaryIO::ReadVector(file, reductionLimits) && reductionLimits == key.reductionLimits &&
+		BinaryIO::Read(file, precision) && precision == key.precision &&
+		BinaryIO::Read(file, sourceHash) && sourceHash == key.sourceHash;
+}
+
+UString::String GeometryCache::GetTempFileName(const Key& key) const
+{
+	return GetFileName(key) + _T(".tmp");
+}
+
+// Data is written to a temporary file which replaces the cache file in FinishWrite, so an interrupted
+// write can't leave a truncated entry behind
+bool GeometryCache::OpenForWrite(const Key& key, std::ofstream& file) const
+{
+	file.open(GetTempFileName(key).c_str(), std::ios::binary);
+	if (!file.is_open() || !file.good())
+		return false;
+
+	return BinaryIO::Write(file, cacheVersion) &&
+		BinaryIO::WriteString(file, key.region) &&
+		BinaryIO::WriteVector(file, key.reductionLimits) &&
+		BinaryIO::Write(file, static_cast<int32_t>(key.precision)) &&
+		BinaryIO::Write(file, key.sourceHash);
+}
+
+bool GeometryCache::FinishWrite(const Key& key, std::ofstream& file, const bool& writeSucceeded) const
+{
+	const std::filesystem::path tempPath(GetTempFileName(key));
+	file.close();
+
+	std::error_code error;
+	if (!writeSucceeded || file.fail())
+	{
+		std::filesystem::remove(tempPath, error);
+		return false;
+	}
+
+	std::filesystem::rename(tempPath, std::filesystem::path(GetFileName(key)), error);
+	return !error;
+}
+
+bool GeometryCache::WriteRings(std::ofstream& file, const std::vector<LinearRing>& rings)
+{
+	if (!BinaryIO::Write(file, static_cast<uint32_t>(rings.size())))
+		return false;
+
+	for (const auto& ring : rings)
+	{
+		if (!BinaryIO::WriteVector(file, ring))
+			return false;
+	}
+
+	return true;
+}
+
+bool GeometryCache::ReadRings(std::ifstream& file, std::vector<LinearRing>& rings)
+{
+	uint32_t size;
+	if (!BinaryIO::ReadCount(file, sizeof(uint32_t), size))// Each element begins with its own count
+		return false;
+
+	rings.resize(size);
+	for (auto& ring : rings)
+	{
+		if (!BinaryIO::ReadVector(file, ring))
+			return false;
+	}
+
+	return true;
+}
+
+bool GeometryCache::WritePolygons(std::ofstream& file, const std::vector<Polygon>& polygons)
+{
+	if (!BinaryIO::Write(file, static_cast<uint32_t>(polygons.size())))
+		return false;
+
+	for (const auto& polygon : polygons)
+	{
+		if (!WriteRings(file, polygon))
+			return false;
+	}
+
+	return true;
+}
+
+bool GeometryCache::ReadPolygons(std::ifstream& file, std::vector<Polygon>& polygons)
+{
+	uint32_t size;
+	if (!BinaryIO::ReadCount(file, sizeof(uint32_t), size))// Each element begins with its own count
+		return false;
+
+	polygons.resize(size);
+	for (auto& polygon : polygons)
+	{
+		if (!ReadRings(file, polygon))
+			return false;
+	}
+
+	return true;
+}
+
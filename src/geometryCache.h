@@ -0,0 +1,62 @@
+// File:  geometryCache.h
+// Date:  10/18/2026
+// Auth:  K. Loux
+// Desc:  Binary cache of converted (parsed and reduced) region geometry, shared by the map generators.
+
+#ifndef GEOMETRY_CACHE_H_
+#define GEOMETRY_CACHE_H_
+
+// Local headers
+#include "kmlToGeoJSONConverter.h"
+#include "utilities/uString.h"
+
+// Standard C++ headers
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <fstream>
+
+// Entries are keyed on the region, the reduction limits and the coordinate precision.  A hash of the
+// source geometry is stored with each entry, so changes to the source cause the entry to be rebuilt.
+// The full key is stored in each file and checked when it is opened, so hash collisions in file names
+// are harmless.
+class GeometryCache
+{
+public:
+	explicit GeometryCache(const UString::String& directory);
+
+	static const UString::String fileExtension;
+
+	struct Key
+	{
+		std::string region;// Region code, boundary file name, etc.
+		std::vector<double> reductionLimits;// [km]
+		int precision;// Number of decimal places in source coordinates (negative for full precision)
+		uint64_t sourceHash;
+	};
+
+	// Returned streams are positioned after the header (the caller reads or writes the geometry).
+	// Written entries only replace the cache file when FinishWrite is called with writeSucceeded true.
+	bool OpenForRead(const Key& key, std::ifstream& file) const;
+	bool OpenForWrite(const Key& key, std::ofstream& file) const;
+	bool FinishWrite(const Key& key, std::ofstream& file, const bool& writeSucceeded) const;
+
+	typedef KMLToGeoJSONConverter::LinearRing LinearRing;
+	typedef KMLToGeoJSONConverter::Polygon Polygon;
+
+	static bool WriteRings(std::ofstream& file, const std::vector<LinearRing>& rings);
+	static bool ReadRings(std::ifstream& file, std::vector<LinearRing>& rings);
+	static bool WritePolygons(std::ofstream& file, const std::vector<Polygon>& polygons);
+	static bool ReadPolygons(std::ifstream& file, std::vector<Polygon>& polygons);
+
+private:
+	static const uint16_t cacheVersion;
+	static const std::string::size_type maxNameLength;
+
+	const UString::String directory;
+
+	UString::String GetFileName(const Key& key) const;
+	UString::String GetTempFileName(const Key& key) const;
+};
+
+#endif// GEOMETRY_CACHE_H_
@@ -9,41 +9,90 @@
 // Standard C++ headers
 #include <stack>
 #include <cmath>
+#include <limits>
+#include <algorithm>
 
 const std::vector<Point>::size_type GeometryReducer::sizeThreshold(20);
 
 void GeometryReducer::Reduce(std::vector<Point>& polygon) const
 {
+	std::vector<double> significance;
+	ComputeSignificance(polygon, significance);
+	polygon = Reduce(polygon, significance, epsilon);
+}
+
+void GeometryReducer::ComputeSignificance(const std::vector<Point>& polygon, std::vector<double>& significance) const
+{
+	significance.clear();
 	if (polygon.size() < sizeThreshold)// Not only required for efficiency/preserving small geometries, but we'll crash below if size < 2.
 		return;
 
+	// Convert each vertex only once (x is passed as latitude, same as always)
+	std::vector<Vector3D> wgs84Points(polygon.size());
+	for (std::vector<Point>::size_type i = 0; i < polygon.size(); ++i)
+		wgs84Points[i] = GetWGS84(polygon[i].x, polygon[i].y);
+
 	// Some special handling because we're often working with polygons which start and end with the same point
 	const auto halfSize(polygon.size() / 2);
-	const auto reducedHalf1(DoReduction(std::vector<Point>(polygon.begin(), polygon.begin() + halfSize)));
-	const auto reducedHalf2(DoReduction(std::vector<Point>(polygon.begin() + halfSize, polygon.end())));
-	polygon = reducedHalf1;
-	polygon.insert(polygon.end(), reducedHalf2.begin(), reducedHalf2.end());
+	significance.resize(polygon.size(), 0.0);
+	DoReduction(wgs84Points, 0, halfSize - 1, significance);
+	DoReduction(wgs84Points, halfSize, polygon.size() - 1, significance);
 }
 
-std::vector<Point> GeometryReducer::DoReduction(std::vector<Point> polygon) const
+std::vector<Point> GeometryReducer::Reduce(const std::vector<Point>& polygon, const std::vector<double>& significance, const double& tolerance)
 {
+	if (significance.empty())
+		return polygon;
+
+	// Each retained segment contributes both of its end points (so single-point segments result in repeated points)
 	std::vector<Point> reduced;
-	std::stack<std::vector<Point>> portions;
-	portions.push(polygon);
+	for (std::vector<Point>::size_type start = 0; start < polygon.size();)
+	{
+		auto end(start + 1);
+		while (end < polygon.size() && significance[end] <= tolerance)
+			++end;
+
+		reduced.push_back(polygon[start]);
+		reduced.push_back(polygon[end - 1]);
+		start = end;
+	}
+
+	return reduced;
+}
+
+// Operates on the range of points [first, last].  Segments are split such that the point farthest
+// from the line becomes the first point of the second segment.  The significance of that point is the
+// smallest distance at which it or any of the enclosing segments was split, since a segment is only
+// considered if all enclosing segments were split.
+void GeometryReducer::DoReduction(const std::vector<Vector3D>& points, const std::size_t& first, const std::size_t& last, std::vector<double>& significance) const
+{
+	struct Portion
+	{
+		Portion(const std::size_t& first, const std::size_t& last, const double& limit) : first(first), last(last), limit(limit) {}
+
+		std::size_t first;
+		std::size_t last;
+		double limit;// Smallest split distance of enclosing segments
+	};
+
+	significance[first] = std::numeric_limits<double>::infinity();
+	std::stack<Portion> portions;
+	portions.push(Portion(first, last, std::numeric_limits<double>::infinity()));
 
 	while (!portions.empty())
 	{
-		auto top(portions.top());
+		const auto top(portions.top());
 		portions.pop();
 
-		Vector3D point;
+		const auto& point(points[top.first]);
 		Vector3D direction;
-		ComputeLine(top.front(), top.back(), point, direction);
+		double lengthSquared;
+		ComputeLine(point, points[top.last], direction, lengthSquared);
 		double maxDistance(0.0);
-		unsigned int splitIndex(0);
-		for (unsigned int i = 1; i < top.size(); ++i)
+		std::size_t splitIndex(0);
+		for (auto i = top.first + 1; i <= top.last; ++i)
 		{
-			const double d(GetPerpendicularDistance(point, direction, top[i]));
+			const double d(GetPerpendicularDistance(point, direction, lengthSquared, points[i]));
 			if (d > maxDistance)
 			{
 				splitIndex = i;
@@ -53,51 +102,43 @@ std::vector<Point> GeometryReducer::DoReduction(std::vector<Point> polygon) cons
 
 		if (maxDistance > epsilon)
 		{
-			portions.push(std::vector<Point>(top.begin() + splitIndex, top.end()));
-			portions.push(std::vector<Point>(top.begin(), top.begin() + splitIndex));
-		}
-		else
-		{
-			reduced.push_back(top.front());
-			reduced.push_back(top.back());
+			const double limit(std::min(maxDistance, top.limit));
+			significance[splitIndex] = limit;
+			portions.push(Portion(splitIndex, top.last, limit));
+			portions.push(Portion(top.first, splitIndex - 1, limit));
 		}
 	}
-
-	return reduced;
 }
 
-void GeometryReducer::ComputeLine(const Point& startPoint, const Point& endPoint, Vector3D& point, Vector3D& direction) const
+void GeometryReducer::ComputeLine(const Vector3D& startPoint, const Vector3D& endPoint, Vector3D& direction, double& lengthSquared)
 {
-	point = GetWGS84(startPoint.x, startPoint.y);
-	const auto p2(GetWGS84(endPoint.x, endPoint.y));
-	direction.x = p2.x - point.x;
-	direction.y = p2.y - point.y;
-	direction.z = p2.z - point.z;
+	direction.x = endPoint.x - startPoint.x;
+	direction.y = endPoint.y - startPoint.y;
+	direction.z = endPoint.z - startPoint.z;
+	lengthSquared = direction.x * direction.x + direction.y * direction.y + direction.z * direction.z;// Shortcut because we know direction is not normalized
 }
 
-// Here, x and y are latitude and longitude in degrees.
+// Points are ECEF coordinates from GetWGS84().
 // We compute linear distance (no "curvature of the Earth" effects) in km based on a WGS84 ellipsoid.
-double GeometryReducer::GetPerpendicularDistance(const Vector3D& point, const Vector3D& direction, const Point& testPoint) const
+double GeometryReducer::GetPerpendicularDistance(const Vector3D& point, const Vector3D& direction, const double& lengthSquared, const Vector3D& testPoint)
 {
-	const double lengthSquared(direction.x * direction.x + direction.y * direction.y + direction.z * direction.z);// Shortcut because we know direction is not normalized
-	const auto testPointWGS(GetWGS84(testPoint.x, testPoint.y));
 	Vector3D a;
-	a.x = point.x - testPointWGS.x;
-	a.y = point.y - testPointWGS.y;
-	a.z = point.z - testPointWGS.z;
+	a.x = point.x - testPoint.x;
+	a.y = point.y - testPoint.y;
+	a.z = point.z - testPoint.z;
 	const double t(-(a.x * direction.x + a.y * direction.y + a.z * direction.z) / lengthSquared);
 
 	Vector3D closestPointOnLine;
 	closestPointOnLine.x = point.x + t * direction.x;
 	closestPointOnLine.y = point.y + t * direction.y;
 	closestPointOnLine.z = point.z + t * direction.z;
-	return sqrt((closestPointOnLine.x - testPointWGS.x) * (closestPointOnLine.x - testPointWGS.x) +
-		(closestPointOnLine.y - testPointWGS.y) * (closestPointOnLine.y - testPointWGS.y) +
-		(closestPointOnLine.z - testPointWGS.z) * (closestPointOnLine.z - testPointWGS.z)) / 1000.0;// [km]
+	return sqrt((closestPointOnLine.x - testPoint.x) * (closestPointOnLine.x - testPoint.x) +
+		(closestPointOnLine.y - testPoint.y) * (closestPointOnLine.y - testPoint.y) +
+		(closestPointOnLine.z - testPoint.z) * (closestPointOnLine.z - testPoint.z)) / 1000.0;// [km]
 }
 
 // Altitude is set to zero.
-GeometryReducer::Vector3D GeometryReducer::GetWGS84(const double& latitude, const double& longitude) const
+GeometryReducer::Vector3D GeometryReducer::GetWGS84(const double& latitude, const double& longitude)
 {
 	const double latRad(latitude * M_PI / 180.0);
 	const double longRad(longitude * M_PI / 180.0);
@@ -19,6 +19,12 @@ public:
 
 	void Reduce(std::vector<Point>& polygon) const;
 
+	// Computing significance once allows the polygon to be reduced to any tolerance (not less than epsilon)
+	// without repeating the search.  Points start retained segments for tolerances less than their significance.
+	// Significance is empty for polygons which are too small to be reduced.
+	void ComputeSignificance(const std::vector<Point>& polygon, std::vector<double>& significance) const;
+	static std::vector<Point> Reduce(const std::vector<Point>& polygon, const std::vector<double>& significance, const double& tolerance);
+
 private:
 	static const std::vector<Point>::size_type sizeThreshold;
 	const double epsilon;
@@ -30,11 +36,11 @@ private:
 		double z;
 	};
 
-	void ComputeLine(const Point& startPoint, const Point& endPoint, Vector3D& point, Vector3D& direction) const;
-	double GetPerpendicularDistance(const Vector3D& point, const Vector3D& direction, const Point& testPoint) const;
-	std::vector<Point> DoReduction(std::vector<Point> polygon) const;
+	static void ComputeLine(const Vector3D& startPoint, const Vector3D& endPoint, Vector3D& direction, double& lengthSquared);
+	static double GetPerpendicularDistance(const Vector3D& point, const Vector3D& direction, const double& lengthSquared, const Vector3D& testPoint);
+	void DoReduction(const std::vector<Vector3D>& points, const std::size_t& first, const std::size_t& last, std::vector<double>& significance) const;
 
-	Vector3D GetWGS84(const double& latitude, const double& longitude) const;
+	static Vector3D GetWGS84(const double& latitude, const double& longitude);
 };
 
 #endif// GEOMETRY_REDUCER_H_
@@ -0,0 +1,164 @@
+// File:  jsonWriter.cpp
+// Date:  10/18/2026
+// Auth:  K. Loux
+// Desc:  Streaming JSON writer.
+
+// Local headers
+#include "jsonWriter.h"
+
+// Standard C++ headers
+#include <charconv>
+#include <cmath>
+#include <cassert>
+
+const std::size_t JSONWriter::bufferSize(1048576);
+
+JSONWriter::JSONWriter(std::ostream& stream) : stream(stream)
+{
+	buffer.reserve(bufferSize + 256);
+}
+
+JSONWriter::~JSONWriter()
+{
+	Flush();
+}
+
+void JSONWriter::BeginObject()
+{
+	BeginValue();
+	buffer.push_back('{');
+	hasValues.push_back(false);
+}
+
+void JSONWriter::EndObject()
+{
+	assert(!hasValues.empty() && !afterKey);
+	buffer.push_back('}');
+	hasValues.pop_back();
+	FlushIfFull();
+}
+
+void JSONWriter::BeginArray()
+{
+	BeginValue();
+	buffer.push_back('[');
+	hasValues.push_back(false);
+}
+
+void JSONWriter::EndArray()
+{
+	assert(!hasValues.empty() && !afterKey);
+	buffer.push_back(']');
+	hasValues.pop_back();
+	FlushIfFull();
+}
+
+void JSONWriter::Key(const std::string& key)
+{
+	assert(!afterKey);
+	BeginValue();
+	AppendEscaped(key);
+	buffer.push_back(':');
+	afterKey = true;
+}
+
+void JSONWriter::String(const std::string& value)
+{
+	BeginValue();
+	AppendEscaped(value);
+	FlushIfFull();
+}
+
+// Non-finite values are not valid JSON, so they are written as null (same as cJSON)
+void JSONWriter::Number(const double& value)
+{
+	BeginValue();
+	if (!std::isfinite(value))
+	{
+		buffer.append("null");
+		return;
+	}
+
+	char s[32];
+	const auto result(std::to_chars(s, s + sizeof(s), value));
+	buffer.append(s, result.ptr);
+	FlushIfFull();
+}
+
+void JSONWriter::Integer(const int64_t& value)
+{
+	BeginValue();
+	char s[24];
+	const auto result(std::to_chars(s, s + sizeof(s), value));
+	buffer.append(s, result.ptr);
+	FlushIfFull();
+}
+
+void JSONWriter::Raw(const std::string& text)
+{
+	buffer.append(text);
+	FlushIfFull();
+}
+
+bool JSONWriter::Flush()
+{
+	if (!buffer.empty())
+	{
+		stream.write(buffer.data(), buffer.size());
+		buffer.clear();
+	}
+
+	return stream.good();
+}
+
+void JSONWriter::BeginValue()
+{
+	if (afterKey)
+	{
+		afterKey = false;
+		return;
+	}
+
+	if (hasValues.empty())
+		return;
+
+	if (hasValues.back())
+		buffer.push_back(',');
+	else
+		hasValues.back() = true;
+}
+
+void JSONWriter::AppendEscaped(const std::string& s)
+{
+	const char* hexDigits("0123456789abcdef");
+	buffer.push_back('"');
+	for (const auto& c : s)
+	{
+		if (c == '"' || c == '\\')
+		{
+			buffer.push_back('\\');
+			buffer.push_back(c);
+		}
+		else if (c == '\n')
+			buffer.append("\\n");
+		else if (c == '\r')
+			buffer.append("\\r");
+		else if (c == '\t')
+			buffer.append("\\t");
+		else if (static_cast<unsigned char>(c) < 0x20)
+		{
+			buffer.append("\\u00");
+			buffer.push_back(hexDigits[(c >> 4) & 0xF]);
+			buffer.push_back(hexDigits[c & 0xF]);
+		}
+		else
+			buffer.push_back(c);
+	}
+	buffer.push_back('"');
+}
+
+void JSONWriter::FlushIfFull()
+{
+	if (buffer.size() >= bufferSize)
+		Flush();
+}
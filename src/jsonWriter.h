@@ -0,0 +1,51 @@
+// File:  jsonWriter.h
+// Date:  10/18/2026
+// Auth:  K. Loux
+// Desc:  Streaming JSON writer.
+
+#ifndef JSON_WRITER_H_
+#define JSON_WRITER_H_
+
+// Standard C++ headers
+#include <ostream>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// Writes JSON to the stream as values are added, so large documents never need to be held in memory.
+// Commas are inserted automatically; object members are written by calling Key() before each value.
+class JSONWriter
+{
+public:
+	explicit JSONWriter(std::ostream& stream);
+	~JSONWriter();
+
+	void BeginObject();
+	void EndObject();
+	void BeginArray();
+	void EndArray();
+
+	void Key(const std::string& key);
+	void String(const std::string& value);
+	void Number(const double& value);// Shortest representation which recovers the same value
+	void Integer(const int64_t& value);
+
+	void Raw(const std::string& text);// Written verbatim (for JavaScript surrounding the JSON data)
+
+	bool Flush();// Returns false if writing to the stream failed
+
+private:
+	static const std::size_t bufferSize;
+
+	std::ostream& stream;
+	std::string buffer;
+
+	std::vector<bool> hasValues;// For each open object or array
+	bool afterKey = false;
+
+	void BeginValue();
+	void AppendEscaped(const std::string& s);
+	void FlushIfFull();
+};
+
+#endif// JSON_WRITER_H_
@@ -7,6 +7,8 @@
 #include "kmlLibraryManager.h"
 #include "zipper.h"
 #include "stringUtilities.h"
+#include "preparedGeometry.h"
+#include "boundaryCache.h"
 
 // OS headers
 #include <sys/stat.h>
@@ -15,29 +17,40 @@
 #include <cassert>
 #include <cctype>
 #include <mutex>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <type_traits>
 
 using namespace std::chrono_literals;
 const ThrottledSection::Clock::duration KMLLibraryManager::mapsAccessDelta(std::chrono::steady_clock::duration(20ms));// 50 requests per second
+const std::string::size_type KMLLibraryManager::placemarkReadChunkSize(1048576);
+const UString::String KMLLibraryManager::parentGeometryFileSuffix(_T("_subNational1.kmz"));
+const int KMLLibraryManager::parentGeometryPrecision(-1);
 
 KMLLibraryManager::KMLLibraryManager(const UString::String& libraryPath,
 	const UString::String& eBirdAPIKey, const UString::String& mapsAPIKey,
 	std::basic_ostream<UString::String::value_type>& log, const bool& cleanUpLocationNames,
-	const int& geoJSONPrecision) : libraryPath(libraryPath),
+	const int& geoJSONPrecision, const uint64_t& memoryLimit) : libraryPath(libraryPath),
 	log(log), cleanUpLocationNames(cleanUpLocationNames), geoJSONPrecision(geoJSONPrecision), mapsAPIRateLimiter(mapsAccessDelta),
-	mapsInterface(_T("eBirdDataProcessor"), mapsAPIKey), ebi(eBirdAPIKey)
+	mapsInterface(_T("eBirdDataProcessor"), mapsAPIKey), memoryLimit(memoryLimit), ebi(eBirdAPIKey)
 {
 }
 
 std::unique_ptr<KMLLibraryManager::GeometryInfo> KMLLibraryManager::ReadKML(const UString::String& kmlFileName)
 {
 	// TODO:  Make this work with kmz files, too
-	UString::IFStream file(kmlFileName);
-	UString::OStringStream buffer;
-	buffer << file.rdbuf();
+	std::ifstream file(kmlFileName.c_str(), std::ios::binary);
+	if (!file.is_open() || !file.good())
+	{
+		Cerr << "Failed to open '" << kmlFileName << "' for input\n";
+		return std::unique_ptr<GeometryInfo>();
+	}
 	
 	std::unordered_map<UString::String, GeometryInfo> tempGeometryInfo;
 	ParentGeometryExtractionArguments args(UString::String(), tempGeometryInfo);
-	if (!ForEachPlacemarkTag(UString::ToStringType(buffer.str()), ExtractParentRegionGeometry, args))
+	if (!ForEachPlacemark(file, ExtractParentRegionGeometry, args))
 		return std::unique_ptr<GeometryInfo>();
 
 	if (tempGeometryInfo.size() != 1)
@@ -46,21 +59,21 @@ std::unique_ptr<KMLLibraryManager::GeometryInfo> KMLLibraryManager::ReadKML(cons
 	return std::make_unique<GeometryInfo>(tempGeometryInfo.begin()->second);
 }
 
-UString::String KMLLibraryManager::GetKML(const UString::String& country, const UString::String& subNational1, const UString::String& subNational2)
+KMLLibraryManager::RegionPointer KMLLibraryManager::GetGeometry(const UString::String& country, const UString::String& subNational1, const UString::String& subNational2)
 {
 	assert(!country.empty());
 	assert((!subNational2.empty() && !subNational1.empty()) || subNational2.empty());
 	const UString::String locationIDString(BuildLocationIDString(country, subNational1, subNational2));
-	UString::String kml;
-	if (GetKMLFromMemory(locationIDString, kml))
-		return kml;
+	RegionPointer geometry;
+	if (GetKMLFromMemory(locationIDString, geometry))
+		return geometry;
 
-	if (LoadKMLFromLibrary(country, locationIDString, kml))
-		return kml;
-	else if (CountryLoadedFromLibrary(country))
+	if (LoadKMLFromLibrary(country, locationIDString, geometry))
+		return geometry;
+	else if (LockingCountryLoadedFromLibrary(country))
 	{
 		//log << "Loaded KML for '" << country << "', but no match for '" << locationIDString << '\'' << std::endl;
-		return UString::String();
+		return nullptr;
 	}
 
 	const GlobalKMLFetcher::DetailLevel detailLevel([subNational1, subNational2]()
@@ -75,41 +88,201 @@ UString::String KMLLibraryManager::GetKML(const UString::String& country, const
 		return GlobalKMLFetcher::DetailLevel::SubNational2;
 	}());
 
-	if (DownloadAndStoreKML(country, detailLevel, locationIDString, kml))
-		return kml;
+	if (DownloadAndStoreKML(country, detailLevel, locationIDString, geometry))
+		return geometry;
 	else if (FileExists(libraryPath + country + _T(".kmz")))
 	{
 		//log << "Downloaded KML for '" << country << "', but no match for '" << locationIDString << '\'' << std::endl;
-		return UString::String();
+		return nullptr;
+	}
+
+	return geometry;
+}
+
+bool KMLLibraryManager::GetArchiveHash(const UString::String& country, uint64_t& hash) const
+{
+	BoundaryCache::ArchiveInfo info;
+	if (!GetArchiveInfo(libraryPath + country + _T(".kmz"), geoJSONPrecision, info))
+		return false;
+
+	hash = info.hash;
+	return true;
+}
+
+bool KMLLibraryManager::GetParentArchiveHash(const UString::String& country, uint64_t& hash) const
+{
+	BoundaryCache::ArchiveInfo info;
+	if (!GetArchiveInfo(libraryPath + country + parentGeometryFileSuffix, parentGeometryPrecision, info))
+		return false;
+
+	hash = info.hash;
+	return true;
+}
+
+// The hash is taken from (in order of preference) the value computed earlier in this run, the boundary
+// cache header, or the archive itself, as long as the archive's size and modification time still match
+bool KMLLibraryManager::GetArchiveInfo(const UString::String& archiveFileName, const int& precision, BoundaryCache::ArchiveInfo& info) const
+{
+	if (!BoundaryCache::GetArchiveFileInfo(archiveFileName, info))
+		return false;
+
+	const auto matches([&info](const BoundaryCache::ArchiveInfo& known)
+	{
+		return known.size == info.size && known.modifiedTime == info.modifiedTime;
+	});
+
+	{
+		std::lock_guard<std::mutex> lock(archiveInfoMutex);
+		const auto it(archiveInfo.find(archiveFileName));
+		if (it != archiveInfo.end() && matches(it->second))
+		{
+			info.hash = it->second.hash;
+			return true;
+		}
 	}
 
-	return kml;
+	BoundaryCache::ArchiveInfo cachedInfo;
+	if (BoundaryCache(GetBoundaryCacheFileName(archiveFileName, precision), precision).ReadArchiveInfo(cachedInfo) && matches(cachedInfo))
+		info.hash = cachedInfo.hash;
+	else if (!BoundaryCache::ComputeArchiveHash(archiveFileName, info.hash))
+		return false;
+
+	std::lock_guard<std::mutex> lock(archiveInfoMutex);
+	archiveInfo[archiveFileName] = info;
+	return true;
+}
+
+// Precision is part of the name, so consumers using different precisions keep separate caches
+UString::String KMLLibraryManager::GetBoundaryCacheFileName(const UString::String& archiveFileName, const int& precision)
+{
+	const UString::String archiveExtension(_T(".kmz"));
+	UString::OStringStream ss;
+	if (archiveFileName.length() > archiveExtension.length() &&
+		archiveFileName.compare(archiveFileName.length() - archiveExtension.length(), archiveExtension.length(), archiveExtension) == 0)
+		ss << archiveFileName.substr(0, archiveFileName.length() - archiveExtension.length());
+	else
+		ss << archiveFileName;
+
+	if (precision < 0)
+		ss << _T("_full");
+	else
+		ss << _T("_p") << precision;
+	ss << BoundaryCache::fileExtension;
+	return ss.str();
 }
 
-bool KMLLibraryManager::GetKMLFromMemory(const UString::String& locationId, UString::String& kml) const
+bool KMLLibraryManager::GetKMLFromMemory(const UString::String& locationId, RegionPointer& geometry) const
 {
 	std::shared_lock<std::shared_timed_mutex> lock(mutex);
-	if (NonLockingGetKMLFromMemory(locationId, kml))
+	if (NonLockingGetKMLFromMemory(locationId, geometry))
 	{
-		std::lock_guard<std::mutex> mappedLock(mappedMutex);
-		kmlMappedList.insert(locationId);
+		MarkKMLAsUsed(locationId);
 		return true;
 	}
 	return false;
 }
 
+// Must hold (at least) shared lock on mutex before calling
+void KMLLibraryManager::MarkKMLAsUsed(const UString::String& locationId) const
+{
+	cacheUsage.Touch(CacheKey(CacheType::KML, ExtractCountryFromLocationId(locationId)));
+
+	std::lock_guard<std::mutex> mappedLock(mappedMutex);
+	kmlMappedList.insert(locationId);
+}
+
+bool KMLLibraryManager::LockingCountryLoadedFromLibrary(const UString::String& country) const
+{
+	std::shared_lock<std::shared_timed_mutex> lock(mutex);
+	return CountryLoadedFromLibrary(country);
+}
+
+// Countries are considered to be loaded only if at least one sub-national region was loaded
 bool KMLLibraryManager::CountryLoadedFromLibrary(const UString::String& country) const
 {
-	auto it(kmlMemory.cbegin());
-	for (; it != kmlMemory.end(); ++it)
+	return loadedCountries.find(country) != loadedCountries.end();
+}
+
+// Must hold exclusive lock on mutex before calling
+void KMLLibraryManager::NonLockingAddToMemory(const UString::String& archiveCountry, KMLMapType&& regions)
+{
+	loadedArchives.insert(archiveCountry);
+	auto& keys(kmlKeys[archiveCountry]);
+	uint64_t bytes(0);
+	for (auto& region : regions)
 	{
-		if (it->first.substr(0, country.length() + 1).compare(country + _T(":")) == 0)
-			return true;
+		const auto result(kmlMemory.insert(std::move(region)));
+		if (!result.second)
+			continue;
+
+		keys.push_back(result.first->first);
+
+		bytes += result.first->first.size() * sizeof(UString::Char) + EstimateMemoryUsage(*result.first->second);
+
+		const auto country(ExtractCountryFromLocationId(result.first->first));
+		if (country.length() < result.first->first.length())
+			loadedCountries.insert(country);
+
+		// Pointers to elements remain valid even if kmlMemory is rehashed
+		if (cleanUpLocationNames)
+			regionNameIndices[country].Add(&*result.first);
 	}
-	return false;
+
+	const CacheKey key(CacheType::KML, archiveCountry);
+	cacheUsage.Add(key, bytes);
+	NonLockingEnforceMemoryLimit(key);
 }
 
-bool KMLLibraryManager::NonLockingGetKMLFromMemory(const UString::String& locationId, UString::String& kml) const
+// Must hold exclusive lock on mutex before calling
+void KMLLibraryManager::NonLockingEnforceMemoryLimit(const CacheKey& keep)
+{
+	if (memoryLimit == 0)
+		return;
+
+	for (const auto& key : cacheUsage.SelectForEviction(memoryLimit, keep))
+		NonLockingEvict(key);
+}
+
+// Must hold exclusive lock on mutex before calling
+void KMLLibraryManager::NonLockingEvict(const CacheKey& key)
+{
+	const auto& country(key.second);
+	if (key.first == CacheType::KML)
+	{
+		// Name index refers to elements of kmlMemory, so it must be removed, too
+		regionNameIndices.erase(country);
+		loadedCountries.erase(country);
+		loadedArchives.erase(country);
+		const auto keys(kmlKeys.find(country));
+		if (keys != kmlKeys.end())
+		{
+			for (const auto& locationId : keys->second)
+				kmlMemory.erase(locationId);
+			kmlKeys.erase(keys);
+		}
+	}
+	else
+	{
+		const auto keys(parentGeometryKeys.find(country));
+		if (keys != parentGeometryKeys.end())
+		{
+			for (const auto& name : keys->second)
+				geometryInfo.erase(name);
+			parentGeometryKeys.erase(keys);
+		}
+	}
+
+	cacheUsage.Remove(key);
+}
+
+uint64_t KMLLibraryManager::EstimateMemoryUsage(const BoundaryCache::Region& region)
+{
+	return sizeof(region) + region.name.size() * sizeof(UString::Char) +
+		(region.polygonStarts.size() + region.ringStarts.size()) * sizeof(uint32_t) +
+		(region.longitudes.size() + region.latitudes.size()) * sizeof(double);
+}
+
+bool KMLLibraryManager::NonLockingGetKMLFromMemory(const UString::String& locationId, RegionPointer& geometry) const
 {
 	auto it(kmlMemory.find(locationId));
 	if (it == kmlMemory.end())
@@ -118,11 +291,11 @@ bool KMLLibraryManager::NonLockingGetKMLFromMemory(const UString::String& locati
 			return false;
 
 		if (cleanUpLocationNames)
-			return CheckForInexactMatch(locationId, kml);
+			return CheckForInexactMatch(locationId, geometry);
 		return false;
 	}
 
-	kml = it->second;
+	geometry = it->second;
 	return true;
 }
 
@@ -143,19 +316,30 @@ UString::String KMLLibraryManager::ExtractSubNational1FromLocationId(const UStri
 }
 
 // Load by country
-bool KMLLibraryManager::LoadKMLFromLibrary(const UString::String& country, const UString::String& locationId, UString::String& kml)
+bool KMLLibraryManager::LoadKMLFromLibrary(const UString::String& country, const UString::String& locationId, RegionPointer& geometry)
 {
 	if (!loadManager.TryAccess(country))
 	{
 		loadManager.WaitOn(country);
-		return GetKMLFromMemory(locationId, kml);// Assume other thread succeeded
+		return GetKMLFromMemory(locationId, geometry);// Assume other thread succeeded
 	}
 
 	MutexUtilities::AccessManager::AccessHelper helper(country, loadManager);
-	if (kmlMemory.find(locationId) != kmlMemory.end())
-		return GetKMLFromMemory(locationId, kml);// Another thread loaded it while we were transfering from shared to exclusive access
+	{
+		// Both checks are made under the same lock so the archive can't be evicted from memory between them
+		std::shared_lock<std::shared_timed_mutex> lock(mutex);
+		const auto it(kmlMemory.find(locationId));
+		if (it != kmlMemory.end())
+		{
+			geometry = it->second;// Another thread loaded it while we were transfering from shared to exclusive access
+			MarkKMLAsUsed(locationId);
+			return true;
+		}
+		else if (loadedArchives.find(country) != loadedArchives.end())
+			return false;// Archive was already loaded (i.e. preloaded) and doesn't contain this location - no need to read it again
+	}
 
-	return NonLockingLoadKMLFromLibrary(country, locationId, kml);
+	return NonLockingLoadKMLFromLibrary(country, locationId, geometry);
 }
 
 bool KMLLibraryManager::OpenKMLArchive(const UString::String& fileName, UString::String& kml) const
@@ -180,40 +364,231 @@ bool KMLLibraryManager::OpenKMLArchive(const UString::String& fileName, UString:
 }
 
 // Load by country
-bool KMLLibraryManager::NonLockingLoadKMLFromLibrary(const UString::String& country, const UString::String& locationId, UString::String& kml)
+bool KMLLibraryManager::NonLockingLoadKMLFromLibrary(const UString::String& country, const UString::String& locationId, RegionPointer& geometry)
 {
 	//log << "Attempting to load KML data from archive for '" << country << '\'' << std::endl;
 
-	UString::String rawKML;
-	if (!OpenKMLArchive(libraryPath + country + _T(".kmz"), rawKML))
+	KMLMapType tempMap;
+	if (!ReadCountryFromLibrary(country, 1, tempMap))// Called from the map generator's worker threads
 		return false;
 
-	std::unordered_map<UString::String, UString::String> tempMap;
-	GeometryExtractionArguments args(country, tempMap, geoJSONPrecision);
-	if (!ForEachPlacemarkTag(rawKML, ExtractRegionGeometry, args))
+	std::lock_guard<std::shared_timed_mutex> lock(mutex);
+	NonLockingAddToMemory(country, std::move(tempMap));
+
+	return NonLockingGetKMLFromMemory(locationId, geometry);
+}
+
+bool KMLLibraryManager::ReadCountryFromLibrary(const UString::String& country, const unsigned int& threadCount, KMLMapType& geometry) const
+{
+	std::vector<BoundaryCache::Region> regions;
+	if (!ReadBoundaries(libraryPath + country + _T(".kmz"), country, geoJSONPrecision, ExtractRegionGeometry, threadCount, regions))
 		return false;
 
-	std::lock_guard<std::shared_timed_mutex> lock(mutex);
-	//kmlMemory.merge(std::move(tempMap));// requires C++ 17 - not sure if there's any reason to prefer it over line below
-	kmlMemory.insert(tempMap.begin(), tempMap.end());
+	for (auto& region : regions)
+	{
+		const auto name(region.name);
+		geometry[name] = std::make_shared<const BoundaryCache::Region>(std::move(region));
+	}
 
-	return NonLockingGetKMLFromMemory(locationId, kml);
+	return true;
+}
+
+// Countries for which no archive exists yet are skipped (they are downloaded on demand, as before).
+// Once the memory limit is reached, any remaining countries are also left to be loaded on demand.
+void KMLLibraryManager::PreloadCountries(const std::vector<UString::String>& countries, const uint64_t& preloadLimit)
+{
+	// Preloading beyond the cache limit would only cause countries loaded earlier to be evicted
+	const uint64_t limit([preloadLimit, this]()
+	{
+		if (memoryLimit == 0)
+			return preloadLimit;
+		else if (preloadLimit == 0)
+			return memoryLimit;
+		return std::min(preloadLimit, memoryLimit);
+	}());
+
+	std::vector<UString::String> countriesToLoad;
+	for (const auto& country : countries)
+	{
+		if (!ArchiveLoadedFromLibrary(country) && FileExists(libraryPath + country + _T(".kmz")))
+			countriesToLoad.push_back(country);
+	}
+
+	if (countriesToLoad.empty())
+		return;
+
+	// Threads not needed for loading separate countries are used for decoding within each country
+	PreloadProgress progress(countriesToLoad.size());
+	{
+		const unsigned int totalThreadCount(std::max(1U, std::thread::hardware_concurrency()));
+		const unsigned int threadCount(std::min(totalThreadCount, static_cast<unsigned int>(countriesToLoad.size())));
+		ThreadPool pool(threadCount, 0);
+		for (const auto& country : countriesToLoad)
+			pool.AddJob(std::make_unique<PreloadJobInfo>(country, limit, totalThreadCount / threadCount, progress, *this));
+		pool.WaitForAllJobsComplete();
+	}
+
+	log << "\rPreloaded KML data for " << progress.loadedCount << " of " << progress.countryCount << " countries";
+	if (progress.loadedCount < progress.countryCount)
+		log << " (remaining countries will be loaded as needed)";
+	log << std::endl;
+}
+
+void KMLLibraryManager::PreloadCountry(const UString::String& country, const uint64_t& preloadLimit,
+	const unsigned int& threadCount, PreloadProgress& progress)
+{
+	bool loaded(false);
+	const uint64_t estimatedBytes(EstimateCountryMemoryUsage(country));
+	if (loadManager.TryAccess(country))// If we can't get access, another thread is already loading this country
+	{
+		MutexUtilities::AccessManager::AccessHelper helper(country, loadManager);
+		if (ReservePreloadMemory(estimatedBytes, preloadLimit, progress))
+		{
+			KMLMapType tempMap;
+			if (!ArchiveLoadedFromLibrary(country) && ReadCountryFromLibrary(country, threadCount, tempMap))
+			{
+				std::lock_guard<std::shared_timed_mutex> lock(mutex);
+				NonLockingAddToMemory(country, std::move(tempMap));
+				loaded = true;
+			}
+
+			std::lock_guard<std::mutex> lock(progress.mutex);
+			progress.reservedBytes -= estimatedBytes;
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(progress.mutex);
+	++progress.completeCount;
+	if (loaded)
+		++progress.loadedCount;
+	log << "\rPreloading KML data:  " << progress.completeCount << " of " << progress.countryCount << " countries" << std::flush;
+}
+
+// Countries which are still being loaded count against the limit, so concurrent loads can't overshoot it
+bool KMLLibraryManager::ReservePreloadMemory(const uint64_t& bytes, const uint64_t& preloadLimit, PreloadProgress& progress) const
+{
+	std::lock_guard<std::mutex> lock(progress.mutex);
+	if (preloadLimit > 0 && cacheUsage.GetTotalBytes() + progress.reservedBytes + bytes > preloadLimit)
+		return false;
+
+	progress.reservedBytes += bytes;
+	return true;
+}
+
+// Based on the boundary cache file when it exists (vertices may be stored there as 32-bit integers,
+// but are held in memory as doubles), otherwise on the size of the compressed archive
+uint64_t KMLLibraryManager::EstimateCountryMemoryUsage(const UString::String& country) const
+{
+	BoundaryCache::ArchiveInfo info;
+	if (BoundaryCache::GetArchiveFileInfo(GetBoundaryCacheFileName(libraryPath + country + _T(".kmz"), geoJSONPrecision), info))
+		return 2 * info.size;
+	else if (BoundaryCache::GetArchiveFileInfo(libraryPath + country + _T(".kmz"), info))
+		return info.size;
+	return 0;
+}
+
+bool KMLLibraryManager::ArchiveLoadedFromLibrary(const UString::String& country) const
+{
+	std::shared_lock<std::shared_timed_mutex> lock(mutex);
+	return loadedArchives.find(country) != loadedArchives.end();
+}
+
+bool KMLLibraryManager::ReadBoundaries(const UString::String& archiveFileName, const UString::String& country, const int& precision,
+	PlacemarkTokenFunction extractFunction, const unsigned int& threadCount, std::vector<BoundaryCache::Region>& regions) const
+{
+	BoundaryCache::ArchiveInfo archive;
+	if (!GetArchiveInfo(archiveFileName, precision, archive))
+	{
+		log << "Failed to open '" << archiveFileName << "' for input" << std::endl;
+		return false;
+	}
+
+	const BoundaryCache cache(GetBoundaryCacheFileName(archiveFileName, precision), precision);
+	if (cache.Load(archive.hash, regions))
+		return true;
+
+	Zipper z;
+	if (!z.OpenArchiveFile(archiveFileName))
+	{
+		log << "Failed to open '" << archiveFileName << "' for input" << std::endl;
+		return false;
+	}
+
+	if (!ExtractBoundaries(z, country, precision, extractFunction, threadCount, regions))
+	{
+		log << "Failed to extract kml data from '" << archiveFileName << '\'' << std::endl;
+		return false;
+	}
+
+	if (!cache.Save(archive, regions))
+		log << "Failed to write boundary cache for '" << archiveFileName << '\'' << std::endl;// Not fatal - the archive will be parsed again next time
+
+	return true;
+}
+
+// Placemarks with geometry that can't be decoded are skipped
+bool KMLLibraryManager::ExtractBoundaries(Zipper& archive, const UString::String& country, const int& precision,
+	PlacemarkTokenFunction extractFunction, const unsigned int& threadCount, std::vector<BoundaryCache::Region>& regions) const
+{
+	std::vector<RegionGeometry> placemarks;
+	GeometryExtractionArguments args(country, placemarks);
+	if (!ForEachPlacemark(archive, extractFunction, args))
+		return false;
+
+	std::vector<BoundaryCache::Region> builtRegions(placemarks.size());
+	std::vector<uint8_t> built(placemarks.size());
+	if (threadCount > 1)
+	{
+		ThreadPool pool(threadCount, 0);
+		for (std::size_t i = 0; i < placemarks.size(); ++i)
+			pool.AddJob(std::make_unique<BuildRegionJobInfo>(placemarks[i], precision, builtRegions[i], built[i]));
+		pool.WaitForAllJobsComplete();
+	}
+	else
+	{
+		for (std::size_t i = 0; i < placemarks.size(); ++i)
+			BuildRegionJobInfo(placemarks[i], precision, builtRegions[i], built[i]).DoJob();
+	}
+
+	regions.clear();
+	for (std::size_t i = 0; i < builtRegions.size(); ++i)
+	{
+		if (built[i])
+			regions.push_back(std::move(builtRegions[i]));
+		else
+			log << "Failed to decode geometry for '" << placemarks[i].locationId << '\'' << std::endl;
+	}
+
+	return true;
+}
+
+void KMLLibraryManager::BuildRegionJobInfo::DoJob()
+{
+	if (precision >= 0)
+	{
+		std::string adjustedKML;
+		AdjustPrecision(placemark.kml, precision, adjustedKML);
+		placemark.kml.swap(adjustedKML);
+	}
+
+	built = BoundaryCache::BuildRegion(placemark.locationId, placemark.kml, region) ? 1 : 0;
+	std::string().swap(placemark.kml);
 }
 
 // Download by country
 bool KMLLibraryManager::DownloadAndStoreKML(const UString::String& country,
-	const GlobalKMLFetcher::DetailLevel& detailLevel, const UString::String& locationId, UString::String& kml)
+	const GlobalKMLFetcher::DetailLevel& detailLevel, const UString::String& locationId, RegionPointer& geometry)
 {
 	if (!downloadManager.TryAccess(country))
 	{
 		downloadManager.WaitOn(country);
-		return GetKMLFromMemory(locationId, kml);// Assume other thread succeeded
+		return GetKMLFromMemory(locationId, geometry);// Assume other thread succeeded
 	}
 
 	MutexUtilities::AccessManager::AccessHelper helper(country, downloadManager);
 	const UString::String kmzFileName(libraryPath + country + _T(".kmz"));
 	if (FileExists(kmzFileName))
-		return GetKMLFromMemory(locationId, kml);// Another thread downloaded it while we were transfering from shared to exclusive access
+		return LoadKMLFromLibrary(country, locationId, geometry);// Another thread downloaded it while we were transfering from shared to exclusive access (may since have been evicted from memory)
 
 	//log << "Attempting to download KML data for '" << country << '\'' << " at detail level " << static_cast<int>(detailLevel) << std::endl;
 	GlobalKMLFetcher fetcher(log);
@@ -269,7 +644,7 @@ bool KMLLibraryManager::DownloadAndStoreKML(const UString::String& country,
 	if (!z.CloseArchive())
 		return false;
 
-	return LoadKMLFromLibrary(country, locationId, kml);
+	return LoadKMLFromLibrary(country, locationId, geometry);
 }
 
 bool KMLLibraryManager::FileExists(const UString::String& fileName)
@@ -367,56 +742,80 @@ bool KMLLibraryManager::DescriptionIsUnwanted(const UString::String& kmlData, co
 	return description.compare(bodyOfWaterDescription) == 0;
 }
 
-bool KMLLibraryManager::ExtractRegionGeometry(const UString::String& kmlData,
-	const std::string::size_type& offset, AdditionalArguments& args)
+bool KMLLibraryManager::ForEachPlacemark(Zipper& archive, PlacemarkTokenFunction func, AdditionalArguments& args)
 {
-	// NOTE:  Possibly need to search for <Polygon> tag if <MultiGeometry> is not found.
-	// I think <MultiGeometry> is only necessary if there are multiple polygons, although
-	// gadm.org seems to wrap all polygon tags in multigeometry tags, so for now we'll
-	// leave this.
-	const UString::String multiGeometryStartTag(_T("<MultiGeometry>"));
-	const UString::String multiGeometryEndTag(_T("</MultiGeometry>"));
-	UString::String geometryEndTag(multiGeometryEndTag);
-	std::string::size_type geometryStart(kmlData.find(multiGeometryStartTag, offset));
-	if (geometryStart == std::string::npos)
+	if (!archive.OpenFileForReading(0))
+		return false;
+
+	KMLPlacemarkTokenizer tokenizer;
+	std::vector<char> chunk(placemarkReadChunkSize);
+	zip_int64_t bytesRead;
+	while (bytesRead = archive.ReadFromFile(chunk.data(), chunk.size()), bytesRead > 0)
 	{
-		const UString::String geometryStartTag(_T("<Polygon>"));
-		geometryEndTag = _T("</Polygon>");
-		geometryStart = kmlData.find(geometryStartTag, offset);
-		if (geometryStart == std::string::npos)
+		tokenizer.AddData(chunk.data(), static_cast<std::string::size_type>(bytesRead));
+		if (!ProcessAvailablePlacemarks(tokenizer, func, args))
 		{
-			Cerr << "Failed to find geometry start tag\n";
+			archive.CloseFileForReading();
 			return false;
 		}
 	}
 
-	
-	const std::string::size_type geometryEnd(kmlData.find(geometryEndTag, geometryStart));
-	if (geometryEnd == std::string::npos)
+	if (!archive.CloseFileForReading() || bytesRead < 0)
+		return false;
+
+	return tokenizer.IsComplete();
+}
+
+bool KMLLibraryManager::ForEachPlacemark(std::istream& stream, PlacemarkTokenFunction func, AdditionalArguments& args)
+{
+	KMLPlacemarkTokenizer tokenizer;
+	std::vector<char> chunk(placemarkReadChunkSize);
+	while (stream.read(chunk.data(), chunk.size()), stream.gcount() > 0)
+	{
+		tokenizer.AddData(chunk.data(), static_cast<std::string::size_type>(stream.gcount()));
+		if (!ProcessAvailablePlacemarks(tokenizer, func, args))
+			return false;
+	}
+
+	return tokenizer.IsComplete();
+}
+
+bool KMLLibraryManager::ProcessAvailablePlacemarks(KMLPlacemarkTokenizer& tokenizer, PlacemarkTokenFunction func, AdditionalArguments& args)
+{
+	KMLPlacemarkTokenizer::Placemark placemark;
+	while (tokenizer.NextPlacemark(placemark))
+	{
+		// See note in ForEachPlacemarkTag() regarding unwanted descriptions
+		if (placemark.description.compare("<![CDATA[Water body]]>") == 0)
+			continue;
+
+		if (!func(placemark, args))
+			return false;
+	}
+
+	return true;
+}
+
+bool KMLLibraryManager::ExtractRegionGeometry(const KMLPlacemarkTokenizer::Placemark& placemark, AdditionalArguments& args)
+{
+	// NOTE:  Tokenizer looks for <MultiGeometry> or <Polygon> tags, whichever comes first.
+	// gadm.org seems to wrap all polygon tags in multigeometry tags.
+	if (placemark.geometryLength == 0)
 	{
-		Cerr << "Failed to find geometry end tag\n";
+		Cerr << "Failed to find geometry in placemark\n";
 		return false;
 	}
 
 	// Some historical KML library data is in GADM 2.8 format - new format is GADM 3.6
 	// Difference is primarily the way placemark names are stored.  We try the 3.6 way first, and if it fails we try the 2.8 way.
 	UString::String name;
-	const UString::String name1SearchString(_T("SimpleData name=\"NAME_1\""));
-	const UString::String nameSR1(ExtractTagValue(kmlData, offset, name1SearchString));
-	const UString::String nameSR2([&kmlData, &offset, &geometryStart]()
-	{
-		const UString::String name2SearchString(_T("SimpleData name=\"NAME_2\""));
-		if (kmlData.find(name2SearchString) < geometryStart)
-			return ExtractTagValue(kmlData, offset, name2SearchString);
-		return UString::String();
-	}());
+	const UString::String nameSR1(UString::ToStringType(placemark.simpleDataNames[1]));
+	const UString::String nameSR2(UString::ToStringType(placemark.simpleDataNames[2]));
 	bool useCountryNameOnly(false);
 	if (nameSR1.empty())
 	{
-		const UString::String name0SearchString(_T("SimpleData name=\"NAME_0\""));
-		const UString::String nameSR0(ExtractTagValue(kmlData, offset, name0SearchString));
-		if (nameSR0.empty())
-			name = ExtractName(kmlData, offset);
+		if (placemark.simpleDataNames[0].empty())
+			name = UString::ToStringType(placemark.name);
 		else
 			useCountryNameOnly = true;
 	}
@@ -438,63 +837,186 @@ bool KMLLibraryManager::ExtractRegionGeometry(const UString::String& kmlData,
 			return geometryArgs.countryName;
 		return geometryArgs.countryName + _T(":") + name;
 	}());
-	geometryArgs.tempMap[key] = AdjustPrecision(kmlData.substr(geometryStart, geometryEnd - geometryStart + geometryEndTag.length()), geometryArgs.geoJSONPrecision);
+	geometryArgs.regions.push_back(RegionGeometry(key, placemark.GetGeometry()));
 	return true;
 }
 
-UString::String KMLLibraryManager::AdjustPrecision(const UString::String& kml, const int& precision)
+// Coordinates are rewritten directly from the text (no conversion to double), except in unusual cases (e.g. exponential
+// notation or values exactly halfway between two rounded values), where output matches std::fixed formatting
+void KMLLibraryManager::AdjustPrecision(const std::string& kml, const int& precision, std::string& adjustedKML)
 {
+	adjustedKML.clear();
 	if (precision < 0)
-		return kml;
+	{
+		adjustedKML.assign(kml);
+		return;
+	}
 
-	UString::String adjustedKML;
-	const UString::String coordStartTag(_T("<coordinates>"));
+	adjustedKML.reserve(kml.size() + kml.size() / 4);
+	const std::string coordStartTag("<coordinates>");
+	const std::string coordEndTag("</coordinates>");
 	std::string::size_type lastPosition(0), position;
 	while (position = kml.find(coordStartTag, lastPosition), position != std::string::npos)
 	{
 		position += coordStartTag.length();
-		adjustedKML.append(kml.substr(lastPosition, position - lastPosition));
+		adjustedKML.append(kml, lastPosition, position - lastPosition);
 
-		const UString::String coordEndTag(_T("</coordinates>"));
 		const auto segmentEnd(kml.find(coordEndTag, position));
-		assert(segmentEnd != std::string::npos);
+		if (segmentEnd == std::string::npos)
+		{
+			lastPosition = position;
+			break;
+		}
 
-		UString::IStringStream ss(kml.substr(position, segmentEnd - position));
 		// Coordinates are in lat/long pairs, with lat and long separated by a comma, and each pair separated from the next with a space
-		UString::String latLongPair;
+		const char* const end(kml.data() + segmentEnd);
+		const char* pairStart(kml.data() + position);
 		bool firstCoord(true);
-		while (std::getline(ss, latLongPair, UString::Char(' ')))
+		while (pairStart < end)
 		{
+			const char* pairEnd(std::find(pairStart, end, ' '));
 			if (firstCoord)
 				firstCoord = false;
 			else
-				adjustedKML.append(_T(" "));
+				adjustedKML.push_back(' ');
 
-			UString::IStringStream latLongSS(latLongPair);
-			double latitude, longitude;
-			if ((latLongSS >> latitude).fail())
-			{
-				adjustedKML.append(latLongPair);
-				continue;
-			}
+			AppendAdjustedCoordinate(pairStart, pairEnd, precision, adjustedKML);
+			pairStart = pairEnd + 1;
+		}
+		lastPosition = segmentEnd;
+	}
 
-			latLongSS.ignore();// Ignore the comma
-			if ((latLongSS >> longitude).fail())
-			{
-				adjustedKML.append(latLongPair);
-				continue;
-			}
+	adjustedKML.append(kml, lastPosition, std::string::npos);
+}
+
+void KMLLibraryManager::AppendAdjustedCoordinate(const char* start, const char* end, const int& precision, std::string& adjustedKML)
+{
+	const auto originalSize(adjustedKML.size());
+	const char* position(start);
+	while (position < end && std::isspace(static_cast<unsigned char>(*position)))
+		++position;
+
+	if (AppendRoundedNumber(position, end, precision, adjustedKML) && position < end)
+	{
+		++position;// Ignore the comma
+		while (position < end && std::isspace(static_cast<unsigned char>(*position)))
+			++position;
+
+		adjustedKML.push_back(',');
+		if (AppendRoundedNumber(position, end, precision, adjustedKML))
+			return;// Anything following the second value is discarded
+	}
+
+	// Fall back on stream-based parsing for anything unusual
+	adjustedKML.resize(originalSize);
+	const std::string latLongPair(start, end);
+	std::istringstream latLongSS(latLongPair);
+	double latitude, longitude;
+	if ((latLongSS >> latitude).fail())
+	{
+		adjustedKML.append(latLongPair);
+		return;
+	}
+
+	latLongSS.ignore();// Ignore the comma
+	if ((latLongSS >> longitude).fail())
+	{
+		adjustedKML.append(latLongPair);
+		return;
+	}
+
+	std::ostringstream adjPrecisionSS;
+	adjPrecisionSS.precision(precision);
+	adjPrecisionSS << std::fixed << latitude << ',' << longitude;
+	adjustedKML.append(adjPrecisionSS.str());
+}
 
-			UString::OStringStream adjPrecisionSS;
-			adjPrecisionSS.precision(precision);
-			adjPrecisionSS << std::fixed << latitude << ',' << longitude;
-			adjustedKML.append(adjPrecisionSS.str());
+// Appends the decimal number at position (rounded to the specified number of decimal places) and advances
+// position past the number.  Returns false if the text at position is not a plain decimal number.
+bool KMLLibraryManager::AppendRoundedNumber(const char*& position, const char* end, const int& precision, std::string& s)
+{
+	const char* p(position);
+	bool negative(false);
+	if (p < end && (*p == '-' || *p == '+'))
+	{
+		negative = *p == '-';
+		++p;
+	}
+
+	const char* integerStart(p);
+	while (p < end && std::isdigit(static_cast<unsigned char>(*p)))
+		++p;
+	const char* integerEnd(p);
+
+	const char* fractionStart(p);
+	const char* fractionEnd(p);
+	if (p < end && *p == '.')
+	{
+		fractionStart = ++p;
+		while (p < end && std::isdigit(static_cast<unsigned char>(*p)))
+			++p;
+		fractionEnd = p;
+	}
+
+	if (integerStart == integerEnd && fractionStart == fractionEnd)
+		return false;
+	else if (p < end && std::isalpha(static_cast<unsigned char>(*p)))
+		return false;// Exponential notation, etc.
+
+	while (integerEnd - integerStart > 1 && *integerStart == '0')
+		++integerStart;
+
+	// Digits to keep, plus one extra for a possible carry
+	constexpr int maxDigits(64);
+	const int integerDigits(static_cast<int>(integerEnd - integerStart));
+	if (integerDigits + precision + 1 > maxDigits)
+		return false;
+
+	char digits[maxDigits];
+	char* const firstDigit(digits + 1);
+	int digitCount(0);
+	if (integerDigits == 0)
+		firstDigit[digitCount++] = '0';
+	for (const char* d = integerStart; d < integerEnd; ++d)
+		firstDigit[digitCount++] = *d;
+	const int keptIntegerDigits(digitCount);
+
+	const char* fraction(fractionStart);
+	for (int i = 0; i < precision; ++i)
+		firstDigit[digitCount++] = fraction < fractionEnd ? *fraction++ : '0';
+
+	// Exact ties are rounded according to the binary representation of the value, so we leave those to the stream
+	if (fraction < fractionEnd && *fraction == '5' && std::all_of(fraction + 1, fractionEnd, [](const char& c) { return c == '0'; }))
+		return false;
+
+	char* numberStart(firstDigit);
+	if (fraction < fractionEnd && *fraction >= '5')
+	{
+		int i(digitCount - 1);
+		while (i >= 0 && firstDigit[i] == '9')
+			firstDigit[i--] = '0';
+
+		if (i >= 0)
+			++firstDigit[i];
+		else
+		{
+			*(--numberStart) = '1';
+			++digitCount;
 		}
-		lastPosition = segmentEnd;
 	}
 
-	adjustedKML.append(kml.substr(lastPosition));
-	return adjustedKML;
+	const int integerLength(keptIntegerDigits + static_cast<int>(firstDigit - numberStart));
+	if (negative)
+		s.push_back('-');
+	s.append(numberStart, integerLength);
+	if (precision > 0)
+	{
+		s.push_back('.');
+		s.append(numberStart + integerLength, precision);
+	}
+
+	position = p;
+	return true;
 }
 
 bool KMLLibraryManager::FixPlacemarkNames(const UString::String& kmlData,
@@ -548,20 +1070,21 @@ bool KMLLibraryManager::FixPlacemarkNames(const UString::String& kmlData,
 	return true;
 }
 
-bool KMLLibraryManager::ExtractParentRegionGeometry(const UString::String& kmlData,
-	const std::string::size_type& offset, AdditionalArguments& args)
+bool KMLLibraryManager::ExtractParentRegionGeometry(const KMLPlacemarkTokenizer::Placemark& placemark, AdditionalArguments& args)
 {
-	const auto placemarkEnd(kmlData.find(_T("</Placemark>"), offset));
-	if (placemarkEnd == std::string::npos)
-	{
-		Cerr << "Failed to match expected end of placemark\n";
-		return false;
-	}
-
-	const UString::String name(ExtractName(kmlData, offset));
+	const UString::String name(UString::ToStringType(placemark.name));
 	auto& placemarkArgs(static_cast<ParentGeometryExtractionArguments&>(args));
 	placemarkArgs.geometryInfo.insert(std::make_pair(BuildLocationIDString(
-		placemarkArgs.countryName, name, UString::String()), GeometryInfo(kmlData.substr(offset, placemarkEnd - offset))));
+		placemarkArgs.countryName, name, UString::String()), GeometryInfo(UString::ToStringType(placemark.GetText()))));
+	return true;
+}
+
+// Placemarks without polygons are kept (as empty regions) so every parent name can be found
+bool KMLLibraryManager::ExtractParentRegionBoundary(const KMLPlacemarkTokenizer::Placemark& placemark, AdditionalArguments& args)
+{
+	auto& geometryArgs(static_cast<GeometryExtractionArguments&>(args));
+	geometryArgs.regions.push_back(RegionGeometry(BuildLocationIDString(geometryArgs.countryName,
+		UString::ToStringType(placemark.name), UString::String()), placemark.GetGeometry()));
 	return true;
 }
 
@@ -625,30 +1148,27 @@ void KMLLibraryManager::ExpandSainteAbbr(UString::String& s)
 
 bool KMLLibraryManager::RegionNamesMatch(const UString::String& name1, const UString::String& name2)
 {
-	UString::String lower1(name1), lower2(name2);
+	return NormalizeRegionName(name1).compare(NormalizeRegionName(name2)) == 0;
+}
+
+UString::String KMLLibraryManager::NormalizeRegionName(const UString::String& name)
+{
+	UString::String lower(name);
 	auto localToLower([](const UString::Char& c)
 	{
 		return static_cast<UString::Char>(::tolower(c));
 	});
-	std::transform(lower1.begin(), lower1.end(), lower1.begin(), localToLower);
-	std::transform(lower2.begin(), lower2.end(), lower2.begin(), localToLower);
-
-	ExpandSaintAbbr(lower1);
-	ExpandSaintAbbr(lower2);
+	std::transform(lower.begin(), lower.end(), lower.begin(), localToLower);
 
-	ExpandSainteAbbr(lower1);
-	ExpandSainteAbbr(lower2);
+	ExpandSaintAbbr(lower);
+	ExpandSainteAbbr(lower);
 
-	lower1.erase(std::remove_if(lower1.begin(), lower1.end(), [](const UString::Char& c)
+	lower.erase(std::remove_if(lower.begin(), lower.end(), [](const UString::Char& c)
 	{
 		return !std::isalnum(c);
-	}), lower1.end());
-	lower2.erase(std::remove_if(lower2.begin(), lower2.end(), [](const UString::Char& c)
-	{
-		return !std::isalnum(c);
-	}), lower2.end());
+	}), lower.end());
 
-	return lower1.compare(lower2) == 0;
+	return lower;
 }
 
 const std::vector<EBirdInterface::RegionInfo>& KMLLibraryManager::GetSubRegion1Data(const UString::String& countryName)
@@ -700,9 +1220,10 @@ bool KMLLibraryManager::LookupParentRegionName(const UString::String& country,
 		return true;
 	}
 
+	const auto robustPoint(ChooseRobustPoint(childInfo));
 	for (const auto& candidate : parentCandidates)
 	{
-		if (PointIsWithinPolygons(ChooseRobustPoint(childInfo), GetGeometryInfoByName(country, candidate.name)))
+		if (GetGeometryInfoByName(country, candidate.name).GetPreparedGeometry().ContainsPoint(robustPoint))
 		{
 			parentRegionName = candidate.name;
 			return true;
@@ -715,8 +1236,9 @@ bool KMLLibraryManager::LookupParentRegionName(const UString::String& country,
 KMLLibraryManager::GeometryInfo::Point KMLLibraryManager::ChooseRobustPoint(const GeometryInfo& geometry)
 {
 	// First, try a point in the middle of the largest polygon
-	const std::vector<GeometryInfo::Point>* largestPolygon(&geometry.polygons.front());
-	for (const auto& polygon : geometry.polygons)
+	const auto& polygons(geometry.GetPolygons());
+	const std::vector<GeometryInfo::Point>* largestPolygon(&polygons.front());
+	for (const auto& polygon : polygons)
 	{
 		if (polygon.size() > largestPolygon->size())
 			largestPolygon = &polygon;
@@ -729,22 +1251,29 @@ KMLLibraryManager::GeometryInfo::Point KMLLibraryManager::ChooseRobustPoint(cons
 		sumLat += p.latitude;
 	}
 
-	GeometryInfo::Point centerPoint(sumLong / largestPolygon->size(), sumLat / largestPolygon->size());
-
-	// Double check, to ensure we didn't pick a point in the middle of a hole
-	if (PointIsWithinPolygons(centerPoint, geometry))
-		return centerPoint;
+	// Need to ensure we don't pick a point in the middle of a hole (or outside a concave polygon)
+	const GeometryInfo::Point center(sumLong / largestPolygon->size(), sumLat / largestPolygon->size());
+	if (PointIsWithinPolygons(center, geometry))
+		return center;
 
-	// Backup plan - use three consecutive edge points to find a new point, then verify that it's within the polygon
-	unsigned int i;
-	for (i = 2; i < largestPolygon->size(); ++i)
+	// Backup plan is to use three consecutive edge points to find a new point.  Candidates are checked
+	// in order, but classified in a single batch.
+	std::vector<double> longitudes, latitudes;
+	for (unsigned int i = 2; i < largestPolygon->size(); ++i)
 	{
 		sumLong = (*largestPolygon)[i - 2].longitude + (*largestPolygon)[i - 1].longitude + (*largestPolygon)[i].longitude;
 		sumLat = (*largestPolygon)[i - 2].latitude + (*largestPolygon)[i - 1].latitude + (*largestPolygon)[i].latitude;
-		GeometryInfo::Point pointNearEdge(sumLong / 3.0, sumLat / 3.0);
+		longitudes.push_back(sumLong / 3.0);
+		latitudes.push_back(sumLat / 3.0);
+	}
 
-		if (PointIsWithinPolygons(pointNearEdge, geometry))
-			return pointNearEdge;
+	std::vector<uint8_t> inside;
+	geometry.GetPreparedGeometry().ContainsPoints(longitudes, latitudes, inside);
+	const auto firstInside(std::find(inside.begin(), inside.end(), 1));
+	if (firstInside != inside.end())
+	{
+		const auto i(firstInside - inside.begin());
+		return GeometryInfo::Point(longitudes[i], latitudes[i]);
 	}
 
 	// Last resort - choose an arbitrary boundary point
@@ -758,7 +1287,7 @@ bool KMLLibraryManager::PointIsWithinPolygons(const GeometryInfo::Point& p, cons
 	outsidePoint.latitude += 1.0;// 1 deg is a fairly large step
 	outsidePoint.longitude += 1.0;// 1 deg is a fairly large step
 	unsigned int intersectionCount(0);
-	for (const auto& polygon : geometry.polygons)
+	for (const auto& polygon : geometry.GetPolygons())
 	{
 		for (unsigned int i = 1; i < polygon.size(); ++i)
 		{
@@ -821,20 +1350,34 @@ KMLLibraryManager::GeometryInfo KMLLibraryManager::GetGeometryInfoByName(const U
 	const UString::String indexString(BuildLocationIDString(countryName, parentName, UString::String()));
 	std::shared_lock<std::shared_timed_mutex> lock(mutex);
 	auto it(geometryInfo.find(indexString));
+	if (it != geometryInfo.end())
+	{
+		cacheUsage.Touch(CacheKey(CacheType::ParentGeometry, countryName));
+		return it->second;
+	}
+
+	if (missingParentGeometry.find(indexString) != missingParentGeometry.end())
+		return GeometryInfo(UString::String());
+
+	// Entry must be copied before the exclusive lock is released - once it is, another thread may evict it
+	// TODO:  Concurrency could be improved if we used AccessManager here, but it's a little trickier than pattern used in other places.
+	MutexUtilities::AccessUpgrader exclusiveLock(lock);
+	it = geometryInfo.find(indexString);
 	if (it == geometryInfo.end())
 	{
-		// TODO:  Concurrency could be improved if we used AccessManager here, but it's a little trickier than pattern used in other places.
-		MutexUtilities::AccessUpgrader exclusiveLock(lock);
+		// Failure to get the archive isn't remembered - it may only be temporary
+		if (parentGeometryKeys.find(countryName) == parentGeometryKeys.end() && !GetParentGeometryInfo(countryName))
+			return GeometryInfo(UString::String());
+
 		it = geometryInfo.find(indexString);
 		if (it == geometryInfo.end())
 		{
-			if (!GetParentGeometryInfo(countryName))
-				return GeometryInfo(UString::String());
-
-			return geometryInfo.find(indexString)->second;
+			missingParentGeometry.insert(indexString);
+			return GeometryInfo(UString::String());
 		}
 	}
 
+	cacheUsage.Touch(CacheKey(CacheType::ParentGeometry, countryName));
 	return it->second;
 }
 
@@ -879,139 +1422,259 @@ bool KMLLibraryManager::BoundingBoxWithinParentBox(const GeometryInfo::BoundingB
 	return true;
 }
 
+// Downloaded archive is kept in the library, so the geometry can be read again without
+// downloading if it is evicted from memory.
+// Must hold exclusive lock on mutex before calling
 bool KMLLibraryManager::GetParentGeometryInfo(const UString::String& country)
 {
-	GlobalKMLFetcher fetcher(log);
-	std::string result;
-	if (!fetcher.FetchKML(country, GlobalKMLFetcher::DetailLevel::SubNational1, result))
-		return false;
-
-	Zipper z;
-	if (!z.OpenArchiveBytes(result))
+	const unsigned int threadCount(1);// Parent regions are looked up while extracting placemarks on the map generator's worker threads
+	const UString::String archiveFileName(libraryPath + country + parentGeometryFileSuffix);
+	std::vector<BoundaryCache::Region> regions;
+	if (FileExists(archiveFileName))
 	{
-		Cerr << "Failed to open kmz data\n";
-		return false;
+		if (!ReadBoundaries(archiveFileName, country, parentGeometryPrecision, ExtractParentRegionBoundary, threadCount, regions))
+			return false;
 	}
+	else
+	{
+		GlobalKMLFetcher fetcher(log);
+		std::string result;
+		if (!fetcher.FetchKML(country, GlobalKMLFetcher::DetailLevel::SubNational1, result))
+			return false;
 
-	std::string unzippedKML;
-	if (!z.ExtractFile(0, unzippedKML))
+		std::ofstream file(archiveFileName.c_str(), std::ios::binary);
+		if (file.is_open() && file.write(result.c_str(), result.length()))
+		{
+			file.close();
+			if (!ReadBoundaries(archiveFileName, country, parentGeometryPrecision, ExtractParentRegionBoundary, threadCount, regions))
+				return false;
+		}
+		else
+		{
+			log << "Failed to write '" << archiveFileName << '\'' << std::endl;// Not fatal - we'll just need to download it again next time
+
+			Zipper z;
+			if (!z.OpenArchiveBytes(result))
+			{
+				Cerr << "Failed to open kmz data\n";
+				return false;
+			}
+
+			if (!ExtractBoundaries(z, country, parentGeometryPrecision, ExtractParentRegionBoundary, threadCount, regions))
+			{
+				Cerr << "Failed to extract file from kmz archive\n";
+				return false;
+			}
+		}
+	}
+
+	auto& keys(parentGeometryKeys[country]);
+	uint64_t bytes(0);
+	for (auto& region : regions)
 	{
-		Cerr << "Failed to extract file from kmz archive\n";
-		return false;
+		const auto name(region.name);
+		const auto insertResult(geometryInfo.insert(std::make_pair(name, GeometryInfo(std::make_shared<const BoundaryCache::Region>(std::move(region))))));
+		if (!insertResult.second)
+			continue;
+
+		keys.push_back(insertResult.first->first);
+		bytes += insertResult.first->first.size() * sizeof(UString::Char) + insertResult.first->second.sourceSize;
 	}
 
-	z.CloseArchive();
+	const CacheKey key(CacheType::ParentGeometry, country);
+	cacheUsage.Add(key, bytes);
+	NonLockingEnforceMemoryLimit(key);
+	return true;
+}
 
-	ParentGeometryExtractionArguments args(country, geometryInfo);
-	return ForEachPlacemarkTag(UString::ToStringType(unzippedKML), ExtractParentRegionGeometry, args);
+const double KMLLibraryManager::GeometryInfo::longitudeOffset(500.0);// used to handle case of geometry overlapping the international date line
+
+KMLLibraryManager::GeometryInfo::GeometryInfo(const UString::String& kml) : GeometryInfo(std::make_shared<PolygonData>(UString::ToNarrowString(kml)))
+{
 }
 
-bool KMLLibraryManager::ContainsOnlyWhitespace(const UString::String& s)
+KMLLibraryManager::GeometryInfo::PolygonData::PolygonData(std::string&& kml) : kml(std::move(kml))
 {
-	for (const auto& c : s)
-	{
-		if (!std::isspace(c))
-			return false;
-	}
+}
 
-	return true;
+KMLLibraryManager::GeometryInfo::PolygonData::PolygonData(const RegionPointer& region) : region(region)
+{
 }
 
-KMLLibraryManager::GeometryInfo::GeometryInfo(const UString::String& kml) : polygons(ExtractPolygons(kml)), bbox(ComputeBoundingBox(polygons))
+KMLLibraryManager::GeometryInfo::PolygonData::~PolygonData() = default;
+
+KMLLibraryManager::GeometryInfo::GeometryInfo(const RegionPointer& region) : GeometryInfo(std::make_shared<PolygonData>(region),
+	GetRegionBoundingBox(*region), EstimateMemoryUsage(*region))
 {
 }
 
-KMLLibraryManager::GeometryInfo::GeometryInfo(const GeometryInfo& g) : polygons(g.polygons), bbox(g.bbox)
+KMLLibraryManager::GeometryInfo::GeometryInfo(const std::shared_ptr<PolygonData>& polygonData) : GeometryInfo(polygonData,
+	ScanBoundingBox(polygonData->kml), polygonData->kml.size())
 {
 }
 
-KMLLibraryManager::GeometryInfo::GeometryInfo(GeometryInfo&& g) : polygons(std::move(g.polygons)), bbox(std::move(g.bbox))
+KMLLibraryManager::GeometryInfo::GeometryInfo(const std::shared_ptr<PolygonData>& polygonData, const BoundingBox& bbox,
+	const std::size_t& sourceSize) : bbox(bbox), sourceSize(sourceSize), polygonData(polygonData)
 {
 }
 
-KMLLibraryManager::GeometryInfo::BoundingBox KMLLibraryManager::GeometryInfo::ComputeBoundingBox(const PolygonList& polygonList)
+const KMLLibraryManager::GeometryInfo::PolygonList& KMLLibraryManager::GeometryInfo::GetPolygons() const
+{
+	std::call_once(polygonData->decodeFlag, [this]()
+	{
+		if (polygonData->region)
+		{
+			polygonData->polygons = DecodePolygons(*polygonData->region);
+			polygonData->region.reset();
+		}
+		else
+		{
+			polygonData->polygons = DecodePolygons(polygonData->kml);
+			std::string().swap(polygonData->kml);
+		}
+	});
+	return polygonData->polygons;
+}
+
+const PreparedGeometry& KMLLibraryManager::GeometryInfo::GetPreparedGeometry() const
+{
+	std::call_once(polygonData->prepareFlag, [this]()
+	{
+		polygonData->preparedGeometry = std::make_unique<const PreparedGeometry>(*this);
+	});
+	return *polygonData->preparedGeometry;
+}
+
+// Bounding box of every coordinate in the KML, found without storing the polygons.  Empty box if the KML can't be decoded.
+KMLLibraryManager::GeometryInfo::BoundingBox KMLLibraryManager::GeometryInfo::ScanBoundingBox(const std::string& kml)
+{
+	BoundingBox bb(BeginBoundingBox());
+	if (!ForEachCoordinate(kml, []() {}, [&bb](const Point& p) { ExpandBoundingBox(p, bb); }))
+		bb = BeginBoundingBox();// Consistent with empty polygon list returned by DecodePolygons() on failure
+
+	EndBoundingBox(bb);
+	return bb;
+}
+
+KMLLibraryManager::GeometryInfo::BoundingBox KMLLibraryManager::GeometryInfo::GetRegionBoundingBox(const BoundaryCache::Region& region)
+{
+	BoundingBox bb(BeginBoundingBox());
+	if (!region.longitudes.empty())
+	{
+		ExpandBoundingBox(Point(region.minLongitude, region.minLatitude), bb);
+		ExpandBoundingBox(Point(region.maxLongitude, region.maxLatitude), bb);
+	}
+
+	EndBoundingBox(bb);
+	return bb;
+}
+
+KMLLibraryManager::GeometryInfo::BoundingBox KMLLibraryManager::GeometryInfo::BeginBoundingBox()
 {
-	const double longitudeOffset(500.0);// used to handle case of geometry overlapping the international date line
 	BoundingBox bb;
 	bb.northEast.latitude = -90.0;
 	bb.northEast.longitude = -180.0 + longitudeOffset;
 	bb.southWest.latitude = 90.0;
 	bb.southWest.longitude = 180.0 + longitudeOffset;
+	return bb;
+}
 
-	for (const auto& polygon : polygonList)
-	{
-		for (const auto& point : polygon)
-		{
-			if (point.latitude > bb.northEast.latitude)
-				bb.northEast.latitude = point.latitude;
-			if (point.latitude < bb.southWest.latitude)
-				bb.southWest.latitude = point.latitude;
-			if (point.longitude + longitudeOffset > bb.northEast.longitude)
-				bb.northEast.longitude = point.longitude + longitudeOffset;
-			if (point.longitude + longitudeOffset < bb.southWest.longitude)
-				bb.southWest.longitude = point.longitude + longitudeOffset;
-		}
-	}
+void KMLLibraryManager::GeometryInfo::ExpandBoundingBox(const Point& point, BoundingBox& bb)
+{
+	if (point.latitude > bb.northEast.latitude)
+		bb.northEast.latitude = point.latitude;
+	if (point.latitude < bb.southWest.latitude)
+		bb.southWest.latitude = point.latitude;
+	if (point.longitude + longitudeOffset > bb.northEast.longitude)
+		bb.northEast.longitude = point.longitude + longitudeOffset;
+	if (point.longitude + longitudeOffset < bb.southWest.longitude)
+		bb.southWest.longitude = point.longitude + longitudeOffset;
+}
 
+void KMLLibraryManager::GeometryInfo::EndBoundingBox(BoundingBox& bb)
+{
 	bb.northEast.longitude -= longitudeOffset;
 	bb.southWest.longitude -= longitudeOffset;
+}
 
-	return bb;
+KMLLibraryManager::GeometryInfo::PolygonList KMLLibraryManager::GeometryInfo::DecodePolygons(const std::string& kml)
+{
+	PolygonList polygons;
+	if (!ForEachCoordinate(kml, [&polygons]() { polygons.push_back(std::vector<Point>()); },
+		[&polygons](const Point& p) { polygons.back().push_back(p); }))
+		return PolygonList();
+
+	return polygons;
 }
 
-KMLLibraryManager::GeometryInfo::PolygonList KMLLibraryManager::GeometryInfo::ExtractPolygons(const UString::String& kml)
+// Each ring is returned as a separate polygon (same as DecodePolygons() for KML)
+KMLLibraryManager::GeometryInfo::PolygonList KMLLibraryManager::GeometryInfo::DecodePolygons(const BoundaryCache::Region& region)
 {
-	// Assuming that it's not necessary to check for <outerBoundaryIs> and <LinearRing> tags
+	PolygonList polygons(region.ringStarts.size() - 1);
+	for (std::size_t r = 0; r < polygons.size(); ++r)
+	{
+		polygons[r].reserve(region.ringStarts[r + 1] - region.ringStarts[r]);
+		for (auto i = region.ringStarts[r]; i < region.ringStarts[r + 1]; ++i)
+			polygons[r].push_back(Point(region.longitudes[i], region.latitudes[i]));
+	}
 
-	PolygonList polygons;
-	const UString::String coordinatesStartTag(_T("<coordinates>"));
+	return polygons;
+}
+
+// Assuming that it's not necessary to check for <outerBoundaryIs> and <LinearRing> tags.
+// Calls polygonFunction() at the start of each <coordinates> element, and pointFunction() for each coordinate.
+template<typename PolygonFunction, typename PointFunction>
+bool KMLLibraryManager::GeometryInfo::ForEachCoordinate(const std::string& kml, PolygonFunction polygonFunction, PointFunction pointFunction)
+{
+	const std::string coordinatesStartTag("<coordinates>");
+	const std::string coordinatesEndTag("</coordinates>");
 	std::string::size_type startIndex(0);
 	while (startIndex = kml.find(coordinatesStartTag, startIndex), startIndex != std::string::npos)
 	{
-		const UString::String coordinatesEndTag(_T("</coordinates>"));
 		const auto endIndex(kml.find(coordinatesEndTag, startIndex));
 		if (endIndex == std::string::npos)
 			break;
 
-		UString::IStringStream ss(kml.substr(startIndex + coordinatesStartTag.length(), endIndex - startIndex - coordinatesStartTag.length()));
-		UString::String line;
-		std::vector<Point> polygon;
-		while (std::getline(ss, line))
+		polygonFunction();
+
+		// Coordinates are whitespace-separated longitude,latitude[,altitude] tuples
+		const char* position(kml.data() + startIndex + coordinatesStartTag.length());
+		const char* const end(kml.data() + endIndex);
+		while (true)
 		{
-			if (ContainsOnlyWhitespace(line))
-				continue;
+			while (position < end && std::isspace(static_cast<unsigned char>(*position)))
+				++position;
+			if (position == end)
+				break;
 
-			UString::IStringStream lineSS(line);
-			UString::String token;
-			while (std::getline(lineSS, token, UString::Char(' ')))
+			char* numberEnd;
+			Point p;
+			p.longitude = std::strtod(position, &numberEnd);
+			if (numberEnd == position || numberEnd >= end)
 			{
-				if (ContainsOnlyWhitespace(token))
-					continue;
+				Cerr << "Failed to parse longitude value\n";
+				return false;
+			}
 
-				UString::IStringStream tokenSS(token);
-				Point p;
-				if ((tokenSS >> p.longitude).fail())
-				{
-					Cerr << "Failed to parse longitude value\n";
-					return PolygonList();
-				}
-	
-				tokenSS.ignore();
-				if ((tokenSS >> p.latitude).fail())
-				{
-					Cerr << "Failed to parse latitude value\n";
-					return PolygonList();
-				}
-	
-				polygon.push_back(p);
+			position = numberEnd + 1;// Ignore the comma
+			p.latitude = std::strtod(position, &numberEnd);
+			if (numberEnd == position || numberEnd > end)
+			{
+				Cerr << "Failed to parse latitude value\n";
+				return false;
 			}
+
+			pointFunction(p);
+
+			position = numberEnd;
+			while (position < end && !std::isspace(static_cast<unsigned char>(*position)))
+				++position;
 		}
 
-		polygons.push_back(polygon);
 		startIndex = endIndex;
 	}
 
-	return polygons;
+	return true;
 }
 
 KMLLibraryManager::Vector2D KMLLibraryManager::Vector2D::operator+(const Vector2D& v) const
@@ -1056,7 +1719,7 @@ double KMLLibraryManager::Vector2D::Dot(const Vector2D& v) const
 
 // If this method is called, we can assume that the data for this country IS loaded into kmlMemory,
 // but no match was found for the locationId.
-bool KMLLibraryManager::CheckForInexactMatch(const UString::String& locationId, UString::String& kml) const
+bool KMLLibraryManager::CheckForInexactMatch(const UString::String& locationId, RegionPointer& geometry) const
 {
 	const auto country(ExtractCountryFromLocationId(locationId));
 	const auto subNational1(ExtractSubNational1FromLocationId(locationId));
@@ -1086,43 +1749,37 @@ bool KMLLibraryManager::CheckForInexactMatch(const UString::String& locationId,
 			eBirdPlaceInfo = it->second;
 	}*/
 
+	const auto countryIndex(regionNameIndices.find(country));
+	if (countryIndex == regionNameIndices.end())
+		return false;
+	const auto& nameIndex(countryIndex->second);
+
 	// Instead of doing both checks in one loops, we use two loops to avoid bothering the user unless we need to
-	auto it(kmlMemory.begin());
-	for (; it != kmlMemory.end(); ++it)
+	for (const auto& i : nameIndex.FindMatchingNames(NormalizeRegionName(lowerSN1)))
 	{
-		if (country.compare(ExtractCountryFromLocationId(it->first)) != 0)
-			continue;
-
+		const auto& it(nameIndex.entries[i].region);
 		{
 			std::lock_guard<std::mutex> lock(mappedMutex);
 			if (kmlMappedList.find(it->first) != kmlMappedList.end())
 				continue;
 		}
 
-		const auto sn1KMZ(ExtractSubNational1FromLocationId(it->first));
-		const auto lowerSN1KMZ(StringUtilities::ToLower(sn1KMZ));
-
-		if (RegionNamesMatch(lowerSN1, lowerSN1KMZ))
-		{
-			kml = it->second;
-			return MakeCorrectionInKMZ(country, sn1KMZ, subNational1);
-		}
+		geometry = it->second;
+		return MakeCorrectionInKMZ(country, nameIndex.entries[i].subNational1, subNational1);
 	}
 
-	it = kmlMemory.begin();
-	for (; it != kmlMemory.end(); ++it)
+	const double threshold(0.5);
+	for (const auto& i : nameIndex.FindSimilarNames(GenerateBigrams(lowerSN1), threshold))
 	{
-		if (country.compare(ExtractCountryFromLocationId(it->first)) != 0)
-			continue;
-
+		const auto& it(nameIndex.entries[i].region);
 		{
 			std::lock_guard<std::mutex> lock(mappedMutex);
 			if (kmlMappedList.find(it->first) != kmlMappedList.end())
 				continue;
 		}
 
-		const auto sn1KMZ(ExtractSubNational1FromLocationId(it->first));
-		const auto lowerSN1KMZ(StringUtilities::ToLower(sn1KMZ));
+		const auto& sn1KMZ(nameIndex.entries[i].subNational1);
+		const auto& lowerSN1KMZ(nameIndex.entries[i].lowerSubNational1);
 
 		///if (!eBirdPlaceInfo.empty()/* && UString::StringsAreSimilar(lowerSN1, lowerSN1KMZ, 0.1)*/)// Very lax but non-zero tolerance to cut down on google maps requests
 		/*{
@@ -1157,7 +1814,7 @@ bool KMLLibraryManager::CheckForInexactMatch(const UString::String& locationId,
 							<< p1.name << ".  Are these different spellings for the same place? (y/n)" << std::endl;
 						if (GetUserConfirmation())
 						{
-							kml = it->second;
+							geometry = it->second;
 							return MakeCorrectionInKMZ(country, sn1KMZ, subNational1);
 						}
 					}
@@ -1165,10 +1822,9 @@ bool KMLLibraryManager::CheckForInexactMatch(const UString::String& locationId,
 			}
 		}*/
 
-		const double threshold(0.5);
 		const UString::String userInputKey(lowerSN1 + _T(":") + lowerSN1KMZ);
 		std::lock_guard<std::mutex> answeredListLock(userAlreadyAnsweredMutex);
-		if (StringsAreSimilar(lowerSN1, lowerSN1KMZ, threshold) && userAnsweredList.find(userInputKey) == userAnsweredList.end())
+		if (userAnsweredList.find(userInputKey) == userAnsweredList.end())
 		{
 			userAnsweredList.insert(userInputKey);
 			std::unique_lock<std::mutex> lock(userInputMutex);
@@ -1177,7 +1833,7 @@ bool KMLLibraryManager::CheckForInexactMatch(const UString::String& locationId,
 
 			if (GetUserConfirmation())
 			{
-				kml = it->second;
+				geometry = it->second;
 				return MakeCorrectionInKMZ(country, sn1KMZ, subNational1);
 			}
 		}
@@ -1293,56 +1949,94 @@ bool KMLLibraryManager::MakeCorrectionInKMZ(const UString::String& country,
 		UString::ToNarrowString(archiveFileName).c_str()) == 0;
 }
 
-bool KMLLibraryManager::StringsAreSimilar(const UString::String& a, const UString::String& b, const double& threshold)
+// Dice coefficient of the letter pairs (within words) of the two strings
+double KMLLibraryManager::BigramSimilarity(const std::vector<Bigram>& a, const std::vector<Bigram>& b)
 {
-	const auto pairs1(GenerateWordLetterPairs(a));
-	auto pairs2(GenerateWordLetterPairs(b));
-
-	size_t intersection(0);
-	size_t unionValue(pairs1.size() + pairs2.size());
-
-	for (const auto& p1 : pairs1)
+	const std::size_t unionValue(a.size() + b.size());
+	if (unionValue == 0)
+		return 0.0;
+
+	// Both lists are sorted, so repeated pairs are matched at most once each
+	std::size_t intersection(0);
+	auto itA(a.cbegin());
+	auto itB(b.cbegin());
+	while (itA != a.cend() && itB != b.cend())
 	{
-		unsigned int p2Index(0);
-		for (const auto& p2 : pairs2)
+		if (*itA < *itB)
+			++itA;
+		else if (*itB < *itA)
+			++itB;
+		else
 		{
-			if (p1.compare(p2) == 0)
-			{
-				++intersection;
-				pairs2.erase(pairs2.begin() + p2Index);
-				break;
-			}
-			++p2Index;
+			++intersection;
+			++itA;
+			++itB;
 		}
 	}
 
-	return 2.0 * intersection / unionValue > threshold;
+	return 2.0 * intersection / unionValue;
 }
 
-std::vector<UString::String> KMLLibraryManager::GenerateLetterPairs(const UString::String& s)
+// Returns sorted list of letter pairs, generated separately for each space-separated word
+std::vector<KMLLibraryManager::Bigram> KMLLibraryManager::GenerateBigrams(const UString::String& s)
 {
-	std::vector<UString::String> pairs(s.length() - 1);
-	unsigned int i;
-	for (i = 0; i < pairs.size(); ++i)
-		pairs[i] = s.substr(i, 2);
-	return pairs;
+	std::vector<Bigram> bigrams;
+	for (std::string::size_type i = 1; i < s.length(); ++i)
+	{
+		if (s[i - 1] != UString::Char(' ') && s[i] != UString::Char(' '))
+			bigrams.push_back((static_cast<Bigram>(static_cast<std::make_unsigned<UString::Char>::type>(s[i - 1])) << 32)
+				| static_cast<std::make_unsigned<UString::Char>::type>(s[i]));
+	}
+
+	std::sort(bigrams.begin(), bigrams.end());
+	return bigrams;
 }
 
-std::vector<UString::String> KMLLibraryManager::GenerateWordLetterPairs(const UString::String& s)
+void KMLLibraryManager::RegionNameIndex::Add(const KMLMapType::value_type* region)
 {
-	std::vector<UString::String> wordLetterPairs;
+	const auto index(static_cast<uint32_t>(entries.size()));
+	entries.push_back(Entry());
+	auto& entry(entries.back());
+	entry.region = region;
+	entry.subNational1 = ExtractSubNational1FromLocationId(region->first);
+	entry.lowerSubNational1 = StringUtilities::ToLower(entry.subNational1);
+	entry.bigrams = GenerateBigrams(entry.lowerSubNational1);
+
+	normalizedNames[NormalizeRegionName(entry.lowerSubNational1)].push_back(index);
+	for (auto b = entry.bigrams.cbegin(); b != entry.bigrams.cend(); b = std::upper_bound(b, entry.bigrams.cend(), *b))
+		bigramPostings[*b].push_back(index);
+}
 
-	UString::IStringStream ss(s);
-	UString::String token;
-	while (std::getline(ss, token, UString::Char(' ')))
+std::vector<uint32_t> KMLLibraryManager::RegionNameIndex::FindMatchingNames(const UString::String& normalizedName) const
+{
+	const auto it(normalizedNames.find(normalizedName));
+	if (it == normalizedNames.end())
+		return std::vector<uint32_t>();
+	return it->second;
+}
+
+// Names that share no letter pairs with the query can't be similar (for a positive threshold), so only
+// entries found in the posting lists for the query's letter pairs need to be scored.
+// Returned indices are in the order the entries were added.
+std::vector<uint32_t> KMLLibraryManager::RegionNameIndex::FindSimilarNames(const std::vector<Bigram>& bigrams, const double& threshold) const
+{
+	assert(threshold >= 0.0);
+	std::vector<uint32_t> candidates;
+	for (auto b = bigrams.cbegin(); b != bigrams.cend(); b = std::upper_bound(b, bigrams.cend(), *b))
 	{
-		if (token.empty())
-			continue;
-		const auto pairs(GenerateLetterPairs(token));
-		wordLetterPairs.insert(wordLetterPairs.end(), pairs.begin(), pairs.end());
+		const auto postings(bigramPostings.find(*b));
+		if (postings != bigramPostings.end())
+			candidates.insert(candidates.end(), postings->second.begin(), postings->second.end());
 	}
 
-	return wordLetterPairs;
+	std::sort(candidates.begin(), candidates.end());
+	candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+	candidates.erase(std::remove_if(candidates.begin(), candidates.end(), [this, &bigrams, &threshold](const uint32_t& i)
+	{
+		return BigramSimilarity(bigrams, entries[i].bigrams) <= threshold;
+	}), candidates.end());
+
+	return candidates;
 }
 
 bool KMLLibraryManager::GeometryInfo::Point::operator==(const Point& p) const
@@ -13,27 +13,51 @@
 #include "utilities/mutexUtilities.h"
 #include "throttledSection.h"
 #include "googleMapsInterface.h"
+#include "kmlPlacemarkTokenizer.h"
+#include "threadPool.h"
+#include "memoryUsageTracker.h"
+#include "boundaryCache.h"
 
 // Standard C++ headers
 #include <unordered_map>
 #include <shared_mutex>
 #include <unordered_set>
 #include <memory>
+#include <istream>
+#include <cstdint>
+#include <mutex>
+
+// Local forward declarations
+class Zipper;
+class PreparedGeometry;
 
 class KMLLibraryManager
 {
 public:
 	KMLLibraryManager(const UString::String& libraryPath, const UString::String& eBirdAPIKey,
 		const UString::String& mapsAPIKey, std::basic_ostream<UString::String::value_type>& log,
-		const bool& cleanUpLocationNames, const int& geoJSONPrecision);
+		const bool& cleanUpLocationNames, const int& geoJSONPrecision, const uint64_t& memoryLimit);
+
+	// Decoded boundaries are shared with the library's in-memory cache (no copy is made)
+	typedef std::shared_ptr<const BoundaryCache::Region> RegionPointer;
+	RegionPointer GetGeometry(const UString::String& country, const UString::String& subNational1, const UString::String& subNational2);// Null if not found
 
-	UString::String GetKML(const UString::String& country, const UString::String& subNational1, const UString::String& subNational2);
+	// Changes whenever the library archive for the country changes; false if the country is not in the library yet
+	bool GetArchiveHash(const UString::String& country, uint64_t& hash) const;
+	// Same, for the archive of sub-national boundaries used to look up parent regions (only downloaded when needed)
+	bool GetParentArchiveHash(const UString::String& country, uint64_t& hash) const;
+
+	// Loads library data for the specified countries concurrently (preloadLimit is in bytes; zero for no limit)
+	void PreloadCountries(const std::vector<UString::String>& countries, const uint64_t& preloadLimit);
 	
+	// Bounding box is computed on construction, but polygons are only decoded when first requested.
+	// Copies share the decoded polygons.
 	struct GeometryInfo
 	{
 		GeometryInfo(const UString::String& kml);
-		GeometryInfo(const GeometryInfo& g);
-		GeometryInfo(GeometryInfo&& g);
+		explicit GeometryInfo(const RegionPointer& region);
+		GeometryInfo(const GeometryInfo& g) = default;
+		GeometryInfo(GeometryInfo&& g) = default;
 
 		struct Point
 		{
@@ -49,7 +73,8 @@ public:
 
 		typedef std::vector<std::vector<Point>> PolygonList;
 
-		const PolygonList polygons;
+		const PolygonList& GetPolygons() const;
+		const PreparedGeometry& GetPreparedGeometry() const;// Built when first requested (for repeated point-in-polygon tests)
 
 		struct BoundingBox
 		{
@@ -57,9 +82,41 @@ public:
 			Point southWest;
 		};
 		const BoundingBox bbox;
+		const std::size_t sourceSize;// [bytes] size of the data from which the geometry was created (for estimating memory usage)
 
-		static BoundingBox ComputeBoundingBox(const PolygonList& polygonList);
-		static PolygonList ExtractPolygons(const UString::String& kml);
+	private:
+		struct PolygonData
+		{
+			explicit PolygonData(std::string&& kml);
+			explicit PolygonData(const RegionPointer& region);
+			~PolygonData();// Defined where PreparedGeometry is complete
+
+			std::once_flag decodeFlag;
+			std::string kml;// Released once polygons are decoded
+			RegionPointer region;// Used instead of kml for geometry from the library; released once polygons are decoded
+			PolygonList polygons;
+
+			std::once_flag prepareFlag;
+			std::unique_ptr<const PreparedGeometry> preparedGeometry;
+		};
+
+		std::shared_ptr<PolygonData> polygonData;
+
+		explicit GeometryInfo(const std::shared_ptr<PolygonData>& polygonData);
+		GeometryInfo(const std::shared_ptr<PolygonData>& polygonData, const BoundingBox& bbox, const std::size_t& sourceSize);
+
+		static const double longitudeOffset;
+		static BoundingBox BeginBoundingBox();
+		static void ExpandBoundingBox(const Point& p, BoundingBox& bb);
+		static void EndBoundingBox(BoundingBox& bb);
+
+		static BoundingBox ScanBoundingBox(const std::string& kml);
+		static BoundingBox GetRegionBoundingBox(const BoundaryCache::Region& region);
+		static PolygonList DecodePolygons(const std::string& kml);
+		static PolygonList DecodePolygons(const BoundaryCache::Region& region);
+
+		template<typename PolygonFunction, typename PointFunction>
+		static bool ForEachCoordinate(const std::string& kml, PolygonFunction polygonFunction, PointFunction pointFunction);
 	};
 	
 	// To support working with custom KML shapes
@@ -76,14 +133,100 @@ private:
 	mutable ThrottledSection mapsAPIRateLimiter;
 	GoogleMapsInterface mapsInterface;
 
-	typedef std::unordered_map<UString::String, UString::String> KMLMapType;
+	typedef std::unordered_map<UString::String, RegionPointer> KMLMapType;
 	KMLMapType kmlMemory;
+	static uint64_t EstimateMemoryUsage(const BoundaryCache::Region& region);// [bytes]
+
+	typedef uint64_t Bigram;// Pair of adjacent characters
+
+	// Supports inexact matching of sub-national region names within a country
+	struct RegionNameIndex
+	{
+		struct Entry
+		{
+			const KMLMapType::value_type* region;
+			UString::String subNational1;
+			UString::String lowerSubNational1;
+			std::vector<Bigram> bigrams;// sorted
+		};
+
+		std::vector<Entry> entries;
+		std::unordered_map<UString::String, std::vector<uint32_t>> normalizedNames;// values are indices into entries
+		std::unordered_map<Bigram, std::vector<uint32_t>> bigramPostings;// values are indices into entries
+
+		void Add(const KMLMapType::value_type* region);
+		std::vector<uint32_t> FindMatchingNames(const UString::String& normalizedName) const;
+		std::vector<uint32_t> FindSimilarNames(const std::vector<Bigram>& bigrams, const double& threshold) const;
+	};
+
+	// Secondary indices into kmlMemory (protected by mutex along with kmlMemory)
+	std::unordered_set<UString::String> loadedCountries;
+	std::unordered_map<UString::String, RegionNameIndex> regionNameIndices;// key is country name; only populated if cleanUpLocationNames is true
+
+	std::unordered_set<UString::String> loadedArchives;// Countries for which the library archive has been read
+
+	typedef std::unordered_map<UString::String, std::vector<UString::String>> CountryKeyMap;// key is country name
+	CountryKeyMap kmlKeys;// Keys of kmlMemory added from each archive (for eviction)
+
+	void NonLockingAddToMemory(const UString::String& archiveCountry, KMLMapType&& regions);
+	void MarkKMLAsUsed(const UString::String& locationId) const;
+
+	// Memory used by kmlMemory and geometryInfo is limited by removing the data for the least-recently-used
+	// countries.  Removed data is read from the library again the next time it is needed.
+	enum class CacheType
+	{
+		KML,
+		ParentGeometry
+	};
+
+	typedef std::pair<CacheType, UString::String> CacheKey;// second is country name
+	const uint64_t memoryLimit;// [bytes]; zero for no limit
+	mutable MemoryUsageTracker<CacheKey> cacheUsage;
+
+	void NonLockingEnforceMemoryLimit(const CacheKey& keep);
+	void NonLockingEvict(const CacheKey& key);
 
-	bool LoadKMLFromLibrary(const UString::String& country, const UString::String& locationId, UString::String& kml);
+	bool LoadKMLFromLibrary(const UString::String& country, const UString::String& locationId, RegionPointer& geometry);
 	bool DownloadAndStoreKML(const UString::String& country, const GlobalKMLFetcher::DetailLevel& detailLevel,
-		const UString::String& locationId, UString::String& kml);
+		const UString::String& locationId, RegionPointer& geometry);
+
+	bool NonLockingLoadKMLFromLibrary(const UString::String& country, const UString::String& locationId, RegionPointer& geometry);
+	bool ReadCountryFromLibrary(const UString::String& country, const unsigned int& threadCount, KMLMapType& geometry) const;
+	bool ArchiveLoadedFromLibrary(const UString::String& country) const;
+	uint64_t EstimateCountryMemoryUsage(const UString::String& country) const;
+
+	struct PreloadProgress
+	{
+		explicit PreloadProgress(const std::size_t& countryCount) : countryCount(countryCount) {}
+
+		const std::size_t countryCount;
+		std::size_t completeCount = 0;
+		std::size_t loadedCount = 0;
+		uint64_t reservedBytes = 0;// Estimated size of countries currently being loaded
+		std::mutex mutex;
+	};
+
+	bool ReservePreloadMemory(const uint64_t& bytes, const uint64_t& preloadLimit, PreloadProgress& progress) const;
+	void PreloadCountry(const UString::String& country, const uint64_t& preloadLimit, const unsigned int& threadCount, PreloadProgress& progress);
+
+	struct PreloadJobInfo : public ThreadPool::JobInfoBase
+	{
+		PreloadJobInfo(const UString::String& country, const uint64_t& preloadLimit, const unsigned int& threadCount,
+			PreloadProgress& progress, KMLLibraryManager& self) : country(country), preloadLimit(preloadLimit),
+			threadCount(threadCount), progress(progress), self(self) {}
+
+		const UString::String country;
+		const uint64_t preloadLimit;
+		const unsigned int threadCount;
+		PreloadProgress& progress;
+		KMLLibraryManager& self;
+
+		void DoJob() override
+		{
+			self.PreloadCountry(country, preloadLimit, threadCount, progress);
+		}
+	};
 
-	bool NonLockingLoadKMLFromLibrary(const UString::String& country, const UString::String& locationId, UString::String& kml);
 
 	static UString::String BuildLocationIDString(const UString::String& country, const UString::String& subNational1, const UString::String& subNational2);
 	static UString::String BuildSubNationalIDString(const UString::String& subNational1, const UString::String& subNational2);
@@ -94,19 +237,25 @@ private:
 	static bool DescriptionIsUnwanted(const UString::String& kmlData, const std::string::size_type& offset);
 
 	bool CountryLoadedFromLibrary(const UString::String& country) const;
+	bool LockingCountryLoadedFromLibrary(const UString::String& country) const;
 
 	struct AdditionalArguments
 	{
 	};
 
+	struct RegionGeometry
+	{
+		RegionGeometry(const UString::String& locationId, const std::string& kml) : locationId(locationId), kml(kml) {}
+		UString::String locationId;
+		std::string kml;
+	};
+
 	struct GeometryExtractionArguments : public AdditionalArguments
 	{
 		GeometryExtractionArguments(const UString::String& countryName,
-			KMLMapType& tempMap, const int& geoJSONPrecision) : countryName(countryName),
-			tempMap(tempMap), geoJSONPrecision(geoJSONPrecision) {}
+			std::vector<RegionGeometry>& regions) : countryName(countryName), regions(regions) {}
 		const UString::String& countryName;
-		KMLMapType& tempMap;
-		const int& geoJSONPrecision;
+		std::vector<RegionGeometry>& regions;
 	};
 
 	struct ParentRegionFinderArguments : public AdditionalArguments
@@ -130,9 +279,32 @@ private:
 	typedef bool(*PlacemarkFunction)(const UString::String&, const std::string::size_type&, AdditionalArguments&);
 
 	static bool ForEachPlacemarkTag(const UString::String& kmlData, PlacemarkFunction func, AdditionalArguments& args);
-	static bool ExtractRegionGeometry(const UString::String& kmlData, const std::string::size_type& offset, AdditionalArguments& args);
 	bool FixPlacemarkNames(const UString::String& kmlData, const std::string::size_type& offset, AdditionalArguments& args) const;
-	static bool ExtractParentRegionGeometry(const UString::String& kmlData, const std::string::size_type& offset, AdditionalArguments& args);
+
+	// Streaming alternatives to ForEachPlacemarkTag - data is processed as it is read
+	typedef bool(*PlacemarkTokenFunction)(const KMLPlacemarkTokenizer::Placemark&, AdditionalArguments&);
+	static bool ForEachPlacemark(Zipper& archive, PlacemarkTokenFunction func, AdditionalArguments& args);// Reads first file in archive
+	static bool ForEachPlacemark(std::istream& stream, PlacemarkTokenFunction func, AdditionalArguments& args);
+	static bool ProcessAvailablePlacemarks(KMLPlacemarkTokenizer& tokenizer, PlacemarkTokenFunction func, AdditionalArguments& args);
+	static const std::string::size_type placemarkReadChunkSize;
+
+	static bool ExtractRegionGeometry(const KMLPlacemarkTokenizer::Placemark& placemark, AdditionalArguments& args);
+	static bool ExtractParentRegionGeometry(const KMLPlacemarkTokenizer::Placemark& placemark, AdditionalArguments& args);
+	static bool ExtractParentRegionBoundary(const KMLPlacemarkTokenizer::Placemark& placemark, AdditionalArguments& args);
+
+	// Archive data is read from the boundary cache when it is up to date; otherwise the archive is parsed and the cache is rebuilt
+	// threadCount is the number of threads used to decode the placemarks; callers which are already running
+	// on a pool thread should pass one (placemarks are then decoded on the calling thread)
+	bool ReadBoundaries(const UString::String& archiveFileName, const UString::String& country, const int& precision,
+		PlacemarkTokenFunction extractFunction, const unsigned int& threadCount, std::vector<BoundaryCache::Region>& regions) const;
+	bool ExtractBoundaries(Zipper& archive, const UString::String& country, const int& precision,
+		PlacemarkTokenFunction extractFunction, const unsigned int& threadCount, std::vector<BoundaryCache::Region>& regions) const;
+	static UString::String GetBoundaryCacheFileName(const UString::String& archiveFileName, const int& precision);
+
+	// Archive hashes are remembered for as long as the archive's size and modification time don't change
+	bool GetArchiveInfo(const UString::String& archiveFileName, const int& precision, BoundaryCache::ArchiveInfo& info) const;
+	mutable std::unordered_map<UString::String, BoundaryCache::ArchiveInfo> archiveInfo;// key is archive file name
+	mutable std::mutex archiveInfoMutex;
 
 	static bool ContainsMoreThanOneMatch(const UString::String& s, const UString::String& pattern);
 	static UString::String CreatePlacemarkNameString(const UString::String& name);
@@ -155,16 +327,20 @@ private:
 	static bool GetUserConfirmation();
 
 	bool GetParentGeometryInfo(const UString::String& country);
+	static const UString::String parentGeometryFileSuffix;
+	static const int parentGeometryPrecision;// Negative for full precision
 
 	std::unordered_map<UString::String, GeometryInfo> geometryInfo;// key generated with BuildLocationIDString() (empty third argument)
+	CountryKeyMap parentGeometryKeys;// Keys of geometryInfo for each loaded country
+	std::unordered_set<UString::String> missingParentGeometry;// Names not found in the (loaded) parent geometry; kept after eviction
 	GeometryInfo GetGeometryInfoByName(const UString::String& countryName, const UString::String& parentName);
 	static bool BoundingBoxWithinParentBox(const GeometryInfo::BoundingBox& parent, const GeometryInfo::BoundingBox& child);
 	static bool SegmentsIntersect(const GeometryInfo::Point& segment1Point1, const GeometryInfo::Point& segment1Point2,
 		const GeometryInfo::Point& segment2Point1, const GeometryInfo::Point& segment2Point2);
 	static GeometryInfo::Point ChooseRobustPoint(const GeometryInfo& geometry);
 
-	static bool ContainsOnlyWhitespace(const UString::String& s);
 	static bool RegionNamesMatch(const UString::String& name1, const UString::String& name2);
+	static UString::String NormalizeRegionName(const UString::String& name);
 
 	class Vector2D
 	{
@@ -183,8 +359,8 @@ private:
 		double Dot(const Vector2D& v) const;
 	};
 
-	bool GetKMLFromMemory(const UString::String& locationId, UString::String& kml) const;
-	bool NonLockingGetKMLFromMemory(const UString::String& locationId, UString::String& kml) const;
+	bool GetKMLFromMemory(const UString::String& locationId, RegionPointer& geometry) const;
+	bool NonLockingGetKMLFromMemory(const UString::String& locationId, RegionPointer& geometry) const;
 
 	mutable std::shared_timed_mutex mutex;
 	mutable std::mutex userInputMutex;
@@ -205,17 +381,32 @@ private:
 
 	static bool FileExists(const UString::String& fileName);
 
-	bool CheckForInexactMatch(const UString::String& locationId, UString::String& kml) const;
+	bool CheckForInexactMatch(const UString::String& locationId, RegionPointer& geometry) const;
 	static UString::String ExtractCountryFromLocationId(const UString::String& id);
 	static UString::String ExtractSubNational1FromLocationId(const UString::String& id);
 	bool MakeCorrectionInKMZ(const UString::String& country,
 		const UString::String& originalSubNationalMashUp, const UString::String& newSubNationalMashUp) const;
 
-	static bool StringsAreSimilar(const UString::String& a, const UString::String& b, const double& threshold);
-	static std::vector<UString::String> GenerateLetterPairs(const UString::String& s);
-	static std::vector<UString::String> GenerateWordLetterPairs(const UString::String& s);
+	static double BigramSimilarity(const std::vector<Bigram>& a, const std::vector<Bigram>& b);
+	static std::vector<Bigram> GenerateBigrams(const UString::String& s);
+
+	static void AdjustPrecision(const std::string& kml, const int& precision, std::string& adjustedKML);
+	static void AppendAdjustedCoordinate(const char* start, const char* end, const int& precision, std::string& adjustedKML);
+	static bool AppendRoundedNumber(const char*& position, const char* end, const int& precision, std::string& s);
+
+	// Each job writes only to its own (pre-allocated) region and flag
+	struct BuildRegionJobInfo : public ThreadPool::JobInfoBase
+	{
+		BuildRegionJobInfo(RegionGeometry& placemark, const int& precision, BoundaryCache::Region& region,
+			uint8_t& built) : placemark(placemark), precision(precision), region(region), built(built) {}
+
+		RegionGeometry& placemark;
+		const int precision;// Negative for full precision
+		BoundaryCache::Region& region;
+		uint8_t& built;
 
-	static UString::String AdjustPrecision(const UString::String& kml, const int& precision);
+		void DoJob() override;
+	};
 
 	bool OpenKMLArchive(const UString::String& fileName, UString::String& kml) const;
 };
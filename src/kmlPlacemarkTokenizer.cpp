@@ -0,0 +1,130 @@
+// File:  kmlPlacemarkTokenizer.cpp
+// Date:  10/18/2026
+// Auth:  K. Loux
+// Desc:  Single-pass tokenizer for extracting placemarks from KML data as it is read.
+
+// Local headers
+#include "kmlPlacemarkTokenizer.h"
+
+// Standard C++ headers
+#include <algorithm>
+
+const std::string KMLPlacemarkTokenizer::placemarkStartTag("<Placemark>");
+const std::string KMLPlacemarkTokenizer::placemarkEndTag("</Placemark>");
+
+void KMLPlacemarkTokenizer::AddData(const char* data, const std::string::size_type& size)
+{
+	// Discard everything we've finished with
+	const auto keepFrom(std::min(placemarkStart, scanPosition));
+	buffer.erase(0, keepFrom);
+	scanPosition -= keepFrom;
+	if (placemarkStart != std::string::npos)
+		placemarkStart -= keepFrom;
+
+	buffer.append(data, size);
+}
+
+bool KMLPlacemarkTokenizer::NextPlacemark(Placemark& placemark)
+{
+	if (placemarkStart == std::string::npos)
+	{
+		const auto start(buffer.find(placemarkStartTag, scanPosition));
+		if (start == std::string::npos)
+		{
+			// Tag may be split across chunks, so we can't discard the last few characters yet
+			if (buffer.size() >= placemarkStartTag.size())
+				scanPosition = std::max(scanPosition, buffer.size() - placemarkStartTag.size() + 1);
+			return false;
+		}
+
+		placemarkStart = start;
+		scanPosition = start + placemarkStartTag.size();
+	}
+
+	const auto end(buffer.find(placemarkEndTag, scanPosition));
+	if (end == std::string::npos)
+	{
+		scanPosition = std::max(scanPosition, buffer.size() - std::min(buffer.size(), placemarkEndTag.size() - 1));
+		return false;
+	}
+
+	const auto placemarkEnd(end + placemarkEndTag.size());
+	ParsePlacemark(placemarkStart, placemarkEnd, placemark);
+	scanPosition = placemarkEnd;
+	placemarkStart = std::string::npos;
+	return true;
+}
+
+// Forward pass over the tags in the placemark.  Contents of the geometry element are skipped.
+void KMLPlacemarkTokenizer::ParsePlacemark(const std::string::size_type& start, const std::string::size_type& end, Placemark& placemark) const
+{
+	placemark = Placemark();
+	placemark.text = buffer.data() + start;
+	placemark.textLength = end - start;
+
+	const std::string nameTag("<name>");
+	const std::string descriptionTag("<description>");
+	const std::string simpleDataNameTag("<SimpleData name=\"NAME_");
+	const std::string multiGeometryStartTag("<MultiGeometry>");
+	const std::string polygonStartTag("<Polygon>");
+
+	bool foundName(false), foundDescription(false);
+	std::array<bool, 3> foundSimpleDataName = {};
+	std::string::size_type position(start + placemarkStartTag.size());
+	while (position = buffer.find('<', position), position < end)
+	{
+		if (!foundName && TagMatches(position, nameTag))
+		{
+			position = ExtractValue(position + nameTag.size(), end, "</name>", placemark.name);
+			foundName = true;
+		}
+		else if (!foundDescription && TagMatches(position, descriptionTag))
+		{
+			position = ExtractValue(position + descriptionTag.size(), end, "</description>", placemark.description);
+			foundDescription = true;
+		}
+		else if (TagMatches(position, simpleDataNameTag))
+		{
+			const auto indexPosition(position + simpleDataNameTag.size());
+			const std::string::size_type index(buffer[indexPosition] - '0');
+			if (index < foundSimpleDataName.size() && !foundSimpleDataName[index] && TagMatches(indexPosition + 1, "\">") &&
+				(index < 2 || placemark.geometryLength == 0))// Only accept NAME_2 if it comes before the geometry (same as earlier implementation)
+			{
+				position = ExtractValue(indexPosition + 3, end, "</SimpleData>", placemark.simpleDataNames[index]);
+				foundSimpleDataName[index] = true;
+			}
+			else
+				++position;
+		}
+		else if (placemark.geometryLength == 0 && (TagMatches(position, multiGeometryStartTag) || TagMatches(position, polygonStartTag)))
+		{
+			const std::string endTag(TagMatches(position, multiGeometryStartTag) ? "</MultiGeometry>" : "</Polygon>");
+			const auto geometryEnd(buffer.find(endTag, position));
+			if (geometryEnd == std::string::npos || geometryEnd >= end)
+				return;
+
+			placemark.geometryOffset = position - start;
+			placemark.geometryLength = geometryEnd + endTag.size() - position;
+			position = geometryEnd + endTag.size();
+		}
+		else
+			++position;
+	}
+}
+
+bool KMLPlacemarkTokenizer::TagMatches(const std::string::size_type& position, const std::string& tag) const
+{
+	return buffer.compare(position, tag.size(), tag) == 0;
+}
+
+// Returns position following the end tag (or following the start of the value, if end tag is not found)
+std::string::size_type KMLPlacemarkTokenizer::ExtractValue(const std::string::size_type& valueStart, const std::string::size_type& end,
+	const std::string& endTag, std::string& value) const
+{
+	const auto valueEnd(buffer.find(endTag, valueStart));
+	if (valueEnd == std::string::npos || valueEnd >= end)
+		return valueStart;
+
+	value.assign(buffer, valueStart, valueEnd - valueStart);
+	return valueEnd + endTag.size();
+}
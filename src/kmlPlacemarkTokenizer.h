@@ -0,0 +1,56 @@
+// File:  kmlPlacemarkTokenizer.h
+// Date:  10/18/2026
+// Auth:  K. Loux
+// Desc:  Single-pass tokenizer for extracting placemarks from KML data as it is read.
+
+#ifndef KML_PLACEMARK_TOKENIZER_H_
+#define KML_PLACEMARK_TOKENIZER_H_
+
+// Standard C++ headers
+#include <string>
+#include <array>
+
+// Data may be supplied in chunks of any size.  Only the unprocessed portion of the
+// data (i.e. everything since the start of the current placemark) is retained.
+class KMLPlacemarkTokenizer
+{
+public:
+	struct Placemark
+	{
+		std::string name;
+		std::string description;
+		std::array<std::string, 3> simpleDataNames;// Values of NAME_0, NAME_1 and NAME_2 (GADM 3.6 format)
+
+		// Text of the entire placemark (including the Placemark tags), owned by the tokenizer and valid only until the next call to AddData()
+		const char* text = nullptr;
+		std::string::size_type textLength = 0;
+
+		// Location of first <MultiGeometry> or <Polygon> element (including tags) within text; length is zero if not found
+		std::string::size_type geometryOffset = 0;
+		std::string::size_type geometryLength = 0;
+
+		std::string GetText() const { return std::string(text, textLength); }
+		std::string GetGeometry() const { return std::string(text + geometryOffset, geometryLength); }
+	};
+
+	void AddData(const char* data, const std::string::size_type& size);
+	bool NextPlacemark(Placemark& placemark);
+
+	// True if all data supplied so far ends outside of a placemark (i.e. no truncated placemarks)
+	bool IsComplete() const { return placemarkStart == std::string::npos; }
+
+private:
+	static const std::string placemarkStartTag;
+	static const std::string placemarkEndTag;
+
+	std::string buffer;
+	std::string::size_type scanPosition = 0;
+	std::string::size_type placemarkStart = std::string::npos;
+
+	void ParsePlacemark(const std::string::size_type& start, const std::string::size_type& end, Placemark& placemark) const;
+	bool TagMatches(const std::string::size_type& position, const std::string& tag) const;
+	std::string::size_type ExtractValue(const std::string::size_type& valueStart, const std::string::size_type& end,
+		const std::string& endTag, std::string& value) const;
+};
+
+#endif// KML_PLACEMARK_TOKENIZER_H_
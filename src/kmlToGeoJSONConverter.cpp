@@ -10,41 +10,70 @@
 // Standard C++ headers
 #include <iostream>
 #include <sstream>
+#include <algorithm>
+#include <thread>
+
+const std::size_t KMLToGeoJSONConverter::minParallelRingCount(64);
 
 KMLToGeoJSONConverter::KMLToGeoJSONConverter(const std::string& kml, const double& reductionLimit) : reductionLimit(reductionLimit)
 {
 	kmlParsedOK = ParseKML(kml);
 }
 
+// Rings are located first, then extracted and reduced independently (in parallel for large regions)
 bool KMLToGeoJSONConverter::ParseKML(const std::string& kml)
 {
+	const GeometryReducer reducer(reductionLimit);
+	const GeometryReducer* reducerPointer(reductionLimit > 0.0 ? &reducer : nullptr);
+
+	std::vector<RingLocation> rings;
 	std::string::size_type polygonPosition(0);
 	while (polygonPosition = GoToNextPolygon(kml, polygonPosition), polygonPosition != std::string::npos)
 	{
 		polygons.push_back(Polygon());
+
 		auto polygonEnd(GetPolygonEndLocation(kml, polygonPosition));
 		auto lrPosition(polygonPosition);
 		while (lrPosition = GoToNextLinearRing(kml, lrPosition), lrPosition < polygonEnd)
 		{
-			polygons.back().push_back(LinearRing());
-			auto position(lrPosition);
-			Point point;
-			while (ExtractCoordinates(kml, position, point))
-				polygons.back().back().push_back(point);
-			lrPosition = position;
+			RingLocation location;
+			location.polygon = polygons.size() - 1;
+			location.ring = polygons.back().size();
+			location.start = lrPosition;
+			rings.push_back(location);
 
-			if (reductionLimit > 0.0)
-			{
-				GeometryReducer reducer(reductionLimit);
-				reducer.Reduce(polygons.back().back());
-			}
+			polygons.back().push_back(LinearRing());
 		}
 		//polygonPosition = lrPosition;// This was a bug - it sometimes advances too far, resulting in skipped polygons
 	}
 
+	if (rings.size() < minParallelRingCount)
+	{
+		for (const auto& r : rings)
+			ExtractAndReduceRing(kml, r, reducerPointer);
+		return true;
+	}
+
+	ThreadPool pool(std::max(1U, std::thread::hardware_concurrency()), 0);
+	for (const auto& r : rings)
+		pool.AddJob(std::make_unique<RingJobInfo>(kml, r, reducerPointer, *this));
+	pool.WaitForAllJobsComplete();
+
 	return true;
 }
 
+void KMLToGeoJSONConverter::ExtractAndReduceRing(const std::string& kml, const RingLocation& location, const GeometryReducer* reducer)
+{
+	auto& linearRing(polygons[location.polygon][location.ring]);
+	auto position(location.start);
+	Point point;
+	while (ExtractCoordinates(kml, position, point))
+		linearRing.push_back(point);
+
+	if (reducer)
+		reducer->Reduce(linearRing);
+}
+
 std::string::size_type KMLToGeoJSONConverter::GetTagPosition(const std::string& kml,
 	const std::string& tag, const std::string::size_type& start)
 {
@@ -93,6 +122,11 @@ bool KMLToGeoJSONConverter::ExtractCoordinates(const std::string& kml, std::stri
 }
 
 cJSON* KMLToGeoJSONConverter::GetGeoJSON() const
+{
+	return BuildGeoJSON(polygons);
+}
+
+cJSON* KMLToGeoJSONConverter::BuildGeoJSON(const std::vector<Polygon>& polygons)
 {
 	auto geometry(cJSON_CreateObject());
 	if (!geometry)
@@ -9,11 +9,15 @@
 // Local headers
 #include "email/cJSON/cJSON.h"
 #include "point.h"
+#include "threadPool.h"
 
 // Standard C++ headers
 #include <string>
 #include <vector>
 
+// Local forward declarations
+class GeometryReducer;
+
 class KMLToGeoJSONConverter
 {
 public:
@@ -22,15 +26,47 @@ public:
 	cJSON* GetGeoJSON() const;
 	std::string GetKML() const;// For testing purposes
 
+	typedef std::vector<Point> LinearRing;
+	typedef std::vector<LinearRing> Polygon;// First ring is the outer boundary
+
+	const std::vector<Polygon>& GetPolygons() const { return polygons; }
+	static cJSON* BuildGeoJSON(const std::vector<Polygon>& polygons);// For geometry which was converted previously
+
 private:
 	const double reductionLimit;
 	bool kmlParsedOK;
 	bool ParseKML(const std::string& kml);
 
-	typedef std::vector<Point> LinearRing;
-	typedef std::vector<LinearRing> Polygon;
 	std::vector<Polygon> polygons;
 
+	static const std::size_t minParallelRingCount;
+
+	struct RingLocation
+	{
+		std::size_t polygon;
+		std::size_t ring;
+		std::string::size_type start;// Position of the first coordinate
+	};
+
+	void ExtractAndReduceRing(const std::string& kml, const RingLocation& location, const GeometryReducer* reducer);
+
+	// Each job writes only to its own (pre-allocated) ring, so rings are stored in order without locking
+	struct RingJobInfo : public ThreadPool::JobInfoBase
+	{
+		RingJobInfo(const std::string& kml, const RingLocation& location, const GeometryReducer* reducer,
+			KMLToGeoJSONConverter& converter) : kml(kml), location(location), reducer(reducer), converter(converter) {}
+
+		const std::string& kml;
+		const RingLocation location;
+		const GeometryReducer* reducer;
+		KMLToGeoJSONConverter& converter;
+
+		void DoJob() override
+		{
+			converter.ExtractAndReduceRing(kml, location, reducer);
+		}
+	};
+
 	static std::string::size_type GetTagPosition(const std::string& kml, const std::string& tag, const std::string::size_type& start);
 	static std::string::size_type GoToNextPolygon(const std::string& kml, const std::string::size_type& start);
 	static std::string::size_type GetPolygonEndLocation(const std::string& kml, const std::string::size_type& start);
@@ -7,8 +7,9 @@
 #include "mapPageGenerator.h"
 #include "stringUtilities.h"
 #include "utilities.h"
-#include "kmlToGeoJSONConverter.h"
 #include "utilities/mutexUtilities.h"
+#include "vectorTileBuilder.h"
+#include "binaryIO.h"
 
 // Standard C++ headers
 #include <iomanip>
@@ -20,9 +21,16 @@
 #include <set>
 #include <mutex>
 #include <cmath>
+#include <cstdio>
+#include <limits>
+#include <filesystem>
 
 const UString::String MapPageGenerator::htmlExtension(_T(".html"));
 const UString::String MapPageGenerator::dataExtension(_T(".js"));
+const UString::String MapPageGenerator::binaryExtension(_T(".bin"));
+const uint32_t MapPageGenerator::weekDataVersion(1);
+const unsigned int MapPageGenerator::geometryLevelCount(4);
+const double MapPageGenerator::geometryLevelScale(4.0);// Ratio of reduction limits for successive levels
 
 const std::array<MapPageGenerator::NamePair, 48> MapPageGenerator::weekNames = {
 	NamePair(_T("Jan"), _T("January")),
@@ -42,8 +50,13 @@ MapPageGenerator::MapPageGenerator(const LocationFindingParameters& locationFind
 	const std::vector<UString::String>& highDetailCountries,
 	const UString::String& eBirdApiKey, const UString::String& kmlLibraryPath) : highDetailCountries(highDetailCountries),
 	ebi(eBirdApiKey), kmlLibrary(kmlLibraryPath, eBirdApiKey, UString::String()/*Google maps key?*/,
-		log, locationFindingParameters.cleanupKMLLocationNames, locationFindingParameters.geoJSONPrecision),
-	kmlReductionLimit(locationFindingParameters.kmlReductionLimit)
+		log, locationFindingParameters.cleanupKMLLocationNames, locationFindingParameters.geoJSONPrecision,
+		static_cast<uint64_t>(locationFindingParameters.kmlCacheMemoryLimit) * 1048576),
+	geometryLevelLimits(BuildGeometryLevelLimits(locationFindingParameters.kmlReductionLimit)),
+	kmlPreloadMemoryLimit(static_cast<uint64_t>(locationFindingParameters.kmlPreloadMemoryLimit) * 1048576),
+	vectorTileMaxZoom(locationFindingParameters.vectorTileMaxZoom), binaryWeekData(locationFindingParameters.binaryWeekData),
+	geoJSONPrecision(locationFindingParameters.geoJSONPrecision),
+	cleanupKMLLocationNames(locationFindingParameters.cleanupKMLLocationNames), geometryCache(kmlLibraryPath)
 {
 	log.Add(Cout);
 	/*std::unique_ptr<UString::OFStream> f(std::make_unique<UString::OFStream>("temp.log"));// TODO:  Remove
@@ -56,12 +69,24 @@ bool MapPageGenerator::WriteBestLocationsViewerPage(const UString::String& baseO
 	if (!WriteHTML(baseOutputFileName + htmlExtension, baseOutputFileName + dataExtension))
 		return false;
 
-	if (!WriteGeoJSONData(baseOutputFileName + dataExtension, observationProbabilities))
+	if (!WriteGeoJSONData(baseOutputFileName, observationProbabilities))
 		return false;
 
 	return true;
 }
 
+// Without reduction, only a single level is generated
+std::vector<double> MapPageGenerator::BuildGeometryLevelLimits(const double& kmlReductionLimit)
+{
+	if (kmlReductionLimit <= 0.0)
+		return std::vector<double>(1, 0.0);
+
+	std::vector<double> limits(1, kmlReductionLimit);
+	while (limits.size() < geometryLevelCount)
+		limits.push_back(limits.back() * geometryLevelScale);
+	return limits;
+}
+
 bool MapPageGenerator::WriteHTML(const UString::String& fileName, const UString::String& dataFileName) const
 {
 	UString::OFStream file(fileName);
@@ -72,8 +97,9 @@ bool MapPageGenerator::WriteHTML(const UString::String& fileName, const UString:
 	}
 
 	file << "<!DOCTYPE html>\n<html>\n";
+	const bool useVectorTiles(vectorTileMaxZoom >= 0);
 	WriteHeadSection(file);
-	WriteBody(file, dataFileName);
+	WriteBody(file, dataFileName, useVectorTiles, binaryWeekData);
 	file << "</html>\n";
 
 	return true;
@@ -105,7 +131,7 @@ void MapPageGenerator::WriteHeadSection(UString::OStream& f)
 		<< "  </head>\n\n";
 }
 
-void MapPageGenerator::WriteBody(UString::OStream& f, const UString::String& dataFileName)
+void MapPageGenerator::WriteBody(UString::OStream& f, const UString::String& dataFileName, const bool& useVectorTiles, const bool& binaryWeekData)
 {
 	f << "  <body>\n"
 		<< "    <div id=\"mapid\"></div>\n\n"
@@ -164,11 +190,11 @@ void MapPageGenerator::WriteBody(UString::OStream& f, const UString::String& dat
 		<< "        <option value=\"-1\">Cycle</option>\n"
 		<< "      </select>\n"
 		<< "    </div>\n\n";
-	WriteScripts(f);
+	WriteScripts(f, useVectorTiles, binaryWeekData);
 	f << "  </body>\n";
 }
 
-void MapPageGenerator::WriteScripts(UString::OStream& f)
+void MapPageGenerator::WriteScripts(UString::OStream& f, const bool& useVectorTiles, const bool& binaryWeekData)
 {
 	f << "    <script type=\"text/javascript\">\n"
 		<< "      var map = L.map('mapid').setView([37.8, -96], 4);\n\n"
@@ -186,7 +212,7 @@ void MapPageGenerator::WriteScripts(UString::OStream& f)
 		<< "      info.update = function (props) {\n"
 		<< "        var probability = 0;\n"
 		<< "        if (props) {\n"
-		<< "          probability = props.weekData[week].probability;\n"
+		<< "          probability = getProbability(props.index, week);\n"
 		<< "        }\n"
 		<< "        this._div.innerHTML = '<h4>Probability of Needed Observation</h4>Week Starting '\n"
 		<< "          + GetWeekText(week) + '<br />' + (props ?\n"
@@ -196,7 +222,7 @@ void MapPageGenerator::WriteScripts(UString::OStream& f)
 		<< "          : 'Select a region');\n\n"
 		<< "        if (props) {\n"
 		<< "          var fragment = document.createDocumentFragment();\n"
-		<< "          props.weekData[week].birds.forEach(function(species, index) {\n"
+		<< "          getSpeciesList(props.index, week).forEach(function(species, index) {\n"
 		<< "            var opt = document.createElement('option');\n"
 		<< "            opt.text = species;\n"
 		<< "            opt.value = species;\n"
@@ -305,17 +331,14 @@ void MapPageGenerator::WriteScripts(UString::OStream& f)
 		<< "        else\n"
 		<< "          return 'Error';\n"
 		<< "      }\n\n"
-		<< "      info.addTo(map);\n\n"
-		<< "      var geoJson;\n"
-		<< "      function buildColorLayer() {\n"
-		<< "        geoJson = L.geoJson(regionData, {\n"
-		<< "          style: style,\n"
-		<< "          onEachFeature: onEachFeature\n"
-		<< "        }).addTo(map);\n"
-		<< "      }\n\n"
-		<< "      var unhighlightOnExit = true;\n"
-		<< "      var highlightOnEnter = true;\n"
-		<< "      var week = 0;\n"
+		<< "      info.addTo(map);\n\n";
+
+	if (binaryWeekData)
+		WriteBinaryWeekDataScripts(f);
+	else
+		WriteInlineWeekDataScripts(f);
+
+	f << "      var week = 0;\n"
 		<< "      var cycle = false;\n"
 		<< "      var intervalHandle;\n"
 		<< "      function updateMap() {\n"
@@ -331,10 +354,8 @@ void MapPageGenerator::WriteScripts(UString::OStream& f)
 		<< "        updateMapDisplay();\n"
 		<< "      }\n\n"
 		<< "      function updateMapDisplay() {\n"
-		<< "        geoJson.clearLayers();\n"
-		<< "		unhighlightOnExit = true;\n"
-		<< "        highlightOnEnter = true;\n"
-		<< "        buildColorLayer();\n"
+		<< "        loadWeekData(week);\n"
+		<< "        redrawColorLayer();\n"
 		<< "        info.update();\n"
 		<< "	  }\n\n"
 		<< "      function cycleWeek() {\n"
@@ -356,6 +377,226 @@ void MapPageGenerator::WriteScripts(UString::OStream& f)
 		<< "          d == 0   ? '#A9A9A9' :\n"
 		<< "          '#FFFFCC';\n"
 		<< "        }\n\n"
+		<< "      var legend = L.control({position: 'bottomright'});\n\n"
+		<< "      legend.onAdd = function (map) {\n"
+		<< "        var div = L.DomUtil.create('div', 'info legend'),\n"
+		<< "          grades = [0, 15, 30, 40, 50, 60, 70, 80, 90],\n"
+		<< "          labels = [],\n"
+		<< "          from, to;\n\n"
+		<< "        for (var i = 0; i < grades.length; i++) {\n"
+		<< "          from = grades[i];\n"
+		<< "          to = grades[i + 1];\n\n"
+		<< "        labels.push(\n"
+		<< "          '<i style=\"background:' + getColor(from + 1) + '\"></i> ' +\n"
+		<< "          from + (to ? '&ndash;' + to : '+') + '%');\n"
+		<< "        }\n\n"
+		<< "        div.innerHTML = labels.join('<br>');\n"
+		<< "        return div;\n"
+		<< "      };\n\n"
+		<< "      legend.addTo(map);\n\n";
+
+	if (useVectorTiles)
+		WriteVectorTileScripts(f);
+	else
+		WriteTopologyScripts(f);
+
+	if (binaryWeekData)
+	{
+		f << "      if (canFetchWeekData) {\n"
+			<< "        fetchBinary(weekDataFiles.species).then(function(buffer) {\n"
+			<< "          speciesNames = decodeSpeciesNames(buffer);\n"
+			<< "          info.update();\n"
+			<< "        }).catch(function(error) {\n"
+			<< "          console.error(error.message);\n"
+			<< "        });\n"
+			<< "        loadWeekData(week);\n"
+			<< "      } else {\n"
+			<< "        alert('Week data can\\'t be loaded when this page is opened as a local file.  Serve the page over HTTP, or regenerate it with BINARY_WEEK_DATA disabled.');\n"
+			<< "      }\n\n";
+	}
+
+	f << "    </script>\n";
+}
+
+// Week data is fetched from the files written by WriteWeekData() as each week is displayed
+void MapPageGenerator::WriteBinaryWeekDataScripts(UString::OStream& f)
+{
+	f << "      // Week data is decoded into typed arrays (see MapPageGenerator::WriteWeekData() for the format).\n"
+		<< "      // Each week is loaded the first time it is displayed.\n"
+		<< "      var speciesNames;\n"
+		<< "      var weekData = [];\n"
+		<< "      var weekDataRequested = [];\n"
+		<< "      var canFetchWeekData = window.location.protocol != 'file:';// Browsers block fetch() for local files\n"
+		<< "      function createReader(buffer) {\n"
+		<< "        var reader = { view: new DataView(buffer), offset: 0 };\n"
+		<< "        reader.readUint32 = function() {\n"
+		<< "          var value = reader.view.getUint32(reader.offset, true);\n"
+		<< "          reader.offset += 4;\n"
+		<< "          return value;\n"
+		<< "        };\n"
+		<< "        reader.readVarint = function() {\n"
+		<< "          var value = 0;\n"
+		<< "          var scale = 1;\n"
+		<< "          var b;\n"
+		<< "          do {\n"
+		<< "            b = reader.view.getUint8(reader.offset++);\n"
+		<< "            value += (b & 0x7F) * scale;\n"
+		<< "            scale *= 128;\n"
+		<< "          } while (b & 0x80);\n"
+		<< "          return value;\n"
+		<< "        };\n"
+		<< "        return reader;\n"
+		<< "      }\n\n"
+		<< "      function decodeSpeciesNames(buffer) {\n"
+		<< "        var reader = createReader(buffer);\n"
+		<< "        reader.readUint32();// version\n"
+		<< "        var speciesCount = reader.readUint32();\n"
+		<< "        var decoder = new TextDecoder();\n"
+		<< "        var names = new Array(speciesCount);\n"
+		<< "        for (var i = 0; i < speciesCount; i++) {\n"
+		<< "          var length = reader.view.getUint16(reader.offset, true);\n"
+		<< "          names[i] = decoder.decode(new Uint8Array(buffer, reader.offset + 2, length));\n"
+		<< "          reader.offset += 2 + length;\n"
+		<< "        }\n"
+		<< "        return names;\n"
+		<< "      }\n\n"
+		<< "      function decodeWeekData(buffer) {\n"
+		<< "        var reader = createReader(buffer);\n"
+		<< "        var data = {};\n"
+		<< "        reader.readUint32();// version\n"
+		<< "        var regionCount = reader.readUint32();\n"
+		<< "        data.probabilities = new Uint8Array(buffer, reader.offset, regionCount);\n"
+		<< "        reader.offset += regionCount;\n"
+		<< "        data.listStarts = new Uint32Array(regionCount + 1);\n"
+		<< "        for (var i = 0; i < regionCount; i++) {\n"
+		<< "          data.listStarts[i + 1] = data.listStarts[i] + reader.readVarint();\n"
+		<< "        }\n\n"
+		<< "        data.speciesIndices = new Uint32Array(data.listStarts[regionCount]);\n"
+		<< "        for (var i = 0; i < regionCount; i++) {\n"
+		<< "          var index = 0;\n"
+		<< "          for (var j = data.listStarts[i]; j < data.listStarts[i + 1]; j++) {\n"
+		<< "            index += reader.readVarint();\n"
+		<< "            data.speciesIndices[j] = index;\n"
+		<< "          }\n"
+		<< "        }\n\n"
+		<< "        data.frequencies = new Uint16Array(data.speciesIndices.length);\n"
+		<< "        for (var i = 0; i < data.frequencies.length; i++) {\n"
+		<< "          data.frequencies[i] = reader.view.getUint16(reader.offset, true);\n"
+		<< "          reader.offset += 2;\n"
+		<< "        }\n"
+		<< "        return data;\n"
+		<< "      }\n\n"
+		<< "      function fetchBinary(fileName) {\n"
+		<< "        return fetch(fileName).then(function(response) {\n"
+		<< "          if (!response.ok) {\n"
+		<< "            throw new Error('Failed to load ' + fileName + ' (' + response.status + ')');\n"
+		<< "          }\n"
+		<< "          return response.arrayBuffer();\n"
+		<< "        });\n"
+		<< "      }\n\n"
+		<< "      function loadWeekData(requestedWeek) {\n"
+		<< "        if (!canFetchWeekData || weekDataRequested[requestedWeek]) {\n"
+		<< "          return;\n"
+		<< "        }\n\n"
+		<< "        weekDataRequested[requestedWeek] = true;\n"
+		<< "        fetchBinary(weekDataFiles.weeks[requestedWeek]).then(function(buffer) {\n"
+		<< "          weekData[requestedWeek] = decodeWeekData(buffer);\n"
+		<< "          if (requestedWeek == week) {\n"
+		<< "            updateMapDisplay();\n"
+		<< "          }\n"
+		<< "        }).catch(function(error) {\n"
+		<< "          weekDataRequested[requestedWeek] = false;// Try again the next time this week is selected\n"
+		<< "          console.error(error.message);\n"
+		<< "        });\n"
+		<< "      }\n\n"
+		<< "      function getProbability(region, week) {\n"
+		<< "        if (!weekData[week]) {\n"
+		<< "          return 0;\n"
+		<< "        }\n"
+		<< "        return weekData[week].probabilities[region] * 100.0 / 255.0;\n"
+		<< "      }\n\n"
+		<< "      // Most frequent species first\n"
+		<< "      function getSpeciesList(region, week) {\n"
+		<< "        var data = weekData[week];\n"
+		<< "        if (!data || !speciesNames) {\n"
+		<< "          return [];\n"
+		<< "        }\n"
+		<< "        var entries = [];\n"
+		<< "        for (var i = data.listStarts[region]; i < data.listStarts[region + 1]; i++) {\n"
+		<< "          entries.push(i);\n"
+		<< "        }\n"
+		<< "        entries.sort(function(a, b) {\n"
+		<< "          return data.frequencies[b] - data.frequencies[a];\n"
+		<< "        });\n"
+		<< "        return entries.map(function(i) {\n"
+		<< "          return speciesNames[data.speciesIndices[i]] + ' (' + (data.frequencies[i] / 100.0).toFixed(2) + '%)';\n"
+		<< "        });\n"
+		<< "      }\n\n";
+}
+
+// Week data is included in the page data (see WriteInlineWeekData()), so the page also works when opened as a local file
+void MapPageGenerator::WriteInlineWeekDataScripts(UString::OStream& f)
+{
+	f << "      function loadWeekData(requestedWeek) {\n"
+		<< "      }\n\n"
+		<< "      function getProbability(region, week) {\n"
+		<< "        return regionWeekData[region][week].probability;\n"
+		<< "      }\n\n"
+		<< "      function getSpeciesList(region, week) {\n"
+		<< "        return regionWeekData[region][week].birds;\n"
+		<< "      }\n\n";
+}
+
+// Regions are drawn as GeoJSON layers built from the topology, with finer geometry loaded as the map is zoomed.
+// The topology written by TopologyBuilder is simple enough (no transform, MultiPolygon geometries only) to
+// convert here, rather than loading a TopoJSON library.
+void MapPageGenerator::WriteTopologyScripts(UString::OStream& f)
+{
+	f << "      // Adjacent arcs share end points, so the first point of each arc after the first is skipped\n"
+		<< "      function topologyFeatures(topology, collection) {\n"
+		<< "        function buildRing(arcIndices) {\n"
+		<< "          var ring = [];\n"
+		<< "          arcIndices.forEach(function(arcIndex) {\n"
+		<< "            var arc = topology.arcs[arcIndex < 0 ? ~arcIndex : arcIndex];\n"
+		<< "            for (var i = ring.length > 0 ? 1 : 0; i < arc.length; i++) {\n"
+		<< "              ring.push(arc[arcIndex < 0 ? arc.length - 1 - i : i]);\n"
+		<< "            }\n"
+		<< "          });\n"
+		<< "          return ring;\n"
+		<< "        }\n\n"
+		<< "        return {\n"
+		<< "          type: 'FeatureCollection',\n"
+		<< "          features: collection.geometries.map(function(geometry) {\n"
+		<< "            return {\n"
+		<< "              type: 'Feature',\n"
+		<< "              properties: geometry.properties || {},\n"
+		<< "              geometry: {\n"
+		<< "                type: 'MultiPolygon',\n"
+		<< "                coordinates: geometry.arcs.map(function(polygon) { return polygon.map(buildRing); })\n"
+		<< "              }\n"
+		<< "            };\n"
+		<< "          })\n"
+		<< "        };\n"
+		<< "      }\n\n"
+		<< "      var regionData = topologyFeatures(regionTopology, regionTopology.objects.regions);\n"
+		<< "      regionData.features.forEach(function(feature, index) {\n"
+		<< "        feature.properties.index = index;\n"
+		<< "      });\n\n"
+		<< "      var geoJson;\n"
+		<< "      function buildColorLayer() {\n"
+		<< "        geoJson = L.geoJson(regionData, {\n"
+		<< "          style: style,\n"
+		<< "          onEachFeature: onEachFeature\n"
+		<< "        }).addTo(map);\n"
+		<< "      }\n\n"
+		<< "      var unhighlightOnExit = true;\n"
+		<< "      var highlightOnEnter = true;\n"
+		<< "      function redrawColorLayer() {\n"
+		<< "        geoJson.clearLayers();\n"
+		<< "        unhighlightOnExit = true;\n"
+		<< "        highlightOnEnter = true;\n"
+		<< "        buildColorLayer();\n"
+		<< "      }\n\n"
 		<< "      function style(feature) {\n"
 		<< "        return {\n"
 		<< "          weight: 2,\n"
@@ -363,7 +604,7 @@ void MapPageGenerator::WriteScripts(UString::OStream& f)
 		<< "          color: 'white',\n"
 		<< "          dashArray: '1',\n"
 		<< "          fillOpacity: 0.3,\n"
-		<< "          fillColor: getColor(feature.properties.weekData[week].probability)\n"
+		<< "          fillColor: getColor(getProbability(feature.properties.index, week))\n"
 		<< "        };\n"
 		<< "      }\n\n"
 		<< "      var lastClicked;\n"
@@ -423,30 +664,202 @@ void MapPageGenerator::WriteScripts(UString::OStream& f)
 		<< "          click: onClick\n"
 		<< "        });\n"
 		<< "      }\n\n"
-		<< "      var legend = L.control({position: 'bottomright'});\n\n"
-		<< "      legend.onAdd = function (map) {\n"
-		<< "        var div = L.DomUtil.create('div', 'info legend'),\n"
-		<< "          grades = [0, 15, 30, 40, 50, 60, 70, 80, 90],\n"
-		<< "          labels = [],\n"
-		<< "          from, to;\n\n"
-		<< "        for (var i = 0; i < grades.length; i++) {\n"
-		<< "          from = grades[i];\n"
-		<< "          to = grades[i + 1];\n\n"
-		<< "        labels.push(\n"
-		<< "          '<i style=\"background:' + getColor(from + 1) + '\"></i> ' +\n"
-		<< "          from + (to ? '&ndash;' + to : '+') + '%');\n"
+		<< "      var coarsestGeometryLevel = geometryLevels.limits.length - 1;\n"
+		<< "      var currentGeometryLevel = coarsestGeometryLevel;\n"
+		<< "      var requestedGeometryLevel = coarsestGeometryLevel;\n"
+		<< "      var geometryLevelData = [];\n"
+		<< "      var geometryLevelRequested = [];\n"
+		<< "      geometryLevelData[coarsestGeometryLevel] = regionTopology.arcs;\n\n"
+		<< "      // Called by the geometry level data files\n"
+		<< "      function loadGeometryLevel(level, arcs) {\n"
+		<< "        geometryLevelData[level] = arcs;\n"
+		<< "        if (level == requestedGeometryLevel) {\n"
+		<< "          setGeometryLevel(level);\n"
+		<< "        }\n"
+		<< "      }\n\n"
+		<< "      function setGeometryLevel(level) {\n"
+		<< "        regionTopology.arcs = geometryLevelData[level];\n"
+		<< "        topologyFeatures(regionTopology, regionTopology.objects.regions).features.forEach(function(feature, index) {\n"
+		<< "          regionData.features[index].geometry = feature.geometry;\n"
+		<< "        });\n"
+		<< "        currentGeometryLevel = level;\n"
+		<< "        updateMapDisplay();\n"
+		<< "      }\n\n"
+		<< "      // Use the coarsest geometry for which the reduction limit is no larger than one pixel\n"
+		<< "      function chooseGeometryLevel() {\n"
+		<< "        var kmPerPixel = 40075.016686 * Math.cos(map.getCenter().lat * Math.PI / 180.0) / Math.pow(2, map.getZoom() + 8);\n"
+		<< "        var level = 0;\n"
+		<< "        while (level < coarsestGeometryLevel && geometryLevels.limits[level + 1] <= kmPerPixel) {\n"
+		<< "          level++;\n"
+		<< "        }\n"
+		<< "        return level;\n"
+		<< "      }\n\n"
+		<< "      function updateGeometryLevel() {\n"
+		<< "        requestedGeometryLevel = chooseGeometryLevel();\n"
+		<< "        if (requestedGeometryLevel == currentGeometryLevel) {\n"
+		<< "          return;\n"
 		<< "        }\n\n"
-		<< "        div.innerHTML = labels.join('<br>');\n"
-		<< "        return div;\n"
-		<< "      };\n\n"
-		<< "      legend.addTo(map);\n\n"
-		<< "      buildColorLayer();\n\n"
-		<< "    </script>\n";
+		<< "        if (geometryLevelData[requestedGeometryLevel]) {\n"
+		<< "          setGeometryLevel(requestedGeometryLevel);\n"
+		<< "        } else if (!geometryLevelRequested[requestedGeometryLevel]) {\n"
+		<< "          geometryLevelRequested[requestedGeometryLevel] = true;\n"
+		<< "          var script = document.createElement('script');\n"
+		<< "          script.src = geometryLevels.files[requestedGeometryLevel];\n"
+		<< "          document.body.appendChild(script);\n"
+		<< "        }\n"
+		<< "      }\n\n"
+		<< "      map.on('zoomend', updateGeometryLevel);\n\n"
+		<< "      buildColorLayer();\n"
+		<< "      updateGeometryLevel();\n\n";
 }
 
-bool MapPageGenerator::WriteGeoJSONData(const UString::String& fileName,
+// Regions are drawn on canvas tiles from the vector tile pyramid; the region under the cursor is found by
+// hit-testing the loaded tile, since there are no per-region layers to receive mouse events
+void MapPageGenerator::WriteVectorTileScripts(UString::OStream& f)
+{
+	f << "      regionProperties.forEach(function(properties, index) {\n"
+		<< "        properties.index = index;\n"
+		<< "      });\n\n"
+		<< "      var tileEntries = [];\n"
+		<< "      var highlightedRegion = -1;\n"
+		<< "      var regionLocked = false;\n\n"
+		<< "      function getTileKey(x, y, z) {\n"
+		<< "        return x + ':' + y + ':' + z;\n"
+		<< "      }\n\n"
+		<< "      function buildPath(rings) {\n"
+		<< "        var path = new Path2D();\n"
+		<< "        rings.forEach(function(ring) {\n"
+		<< "          path.moveTo(ring[0], ring[1]);\n"
+		<< "          for (var i = 2; i < ring.length; i += 2) {\n"
+		<< "            path.lineTo(ring[i], ring[i + 1]);\n"
+		<< "          }\n"
+		<< "          path.closePath();\n"
+		<< "        });\n"
+		<< "        return path;\n"
+		<< "      }\n\n"
+		<< "      var RegionTileLayer = L.GridLayer.extend({\n"
+		<< "        createTile: function(coords, done) {\n"
+		<< "          var tile = L.DomUtil.create('canvas', 'leaflet-tile');\n"
+		<< "          var size = this.getTileSize();\n"
+		<< "          tile.width = size.x;\n"
+		<< "          tile.height = size.y;\n"
+		<< "          var entry = { key: getTileKey(coords.x, coords.y, coords.z), canvas: tile, features: [] };\n"
+		<< "          tileEntries.push(entry);\n"
+		<< "          fetch(L.Util.template(vectorTiles.url, coords)).then(function(response) {\n"
+		<< "            return response.ok ? response.json() : { features: [] };// Tiles without any regions are not written\n"
+		<< "          }).then(function(data) {\n"
+		<< "            entry.features = data.features.map(function(feature) {\n"
+		<< "              return { index: feature.index, path: buildPath(feature.rings) };\n"
+		<< "            });\n"
+		<< "            drawTile(entry);\n"
+		<< "            done(null, tile);\n"
+		<< "          }).catch(function(error) {\n"
+		<< "            done(error, tile);\n"
+		<< "          });\n"
+		<< "          return tile;\n"
+		<< "        }\n"
+		<< "      });\n\n"
+		<< "      var regionLayer = new RegionTileLayer({ maxNativeZoom: vectorTiles.maxZoom }).addTo(map);\n"
+		<< "      regionLayer.on('tileunload', function(e) {\n"
+		<< "        tileEntries = tileEntries.filter(function(entry) {\n"
+		<< "          return entry.canvas !== e.tile;\n"
+		<< "        });\n"
+		<< "      });\n\n"
+		<< "      function drawFeature(context, feature, scale, highlight) {\n"
+		<< "        context.globalAlpha = highlight ? 0.5 : 0.3;\n"
+		<< "        context.fillStyle = getColor(getProbability(feature.index, week));\n"
+		<< "        context.fill(feature.path, 'evenodd');\n"
+		<< "        context.globalAlpha = 1.0;\n"
+		<< "        context.strokeStyle = highlight ? '#666' : 'white';\n"
+		<< "        context.lineWidth = (highlight ? 5 : 2) / scale;\n"
+		<< "        context.stroke(feature.path);\n"
+		<< "      }\n\n"
+		<< "      // Tile paths are in tile units (0 to vectorTiles.extent)\n"
+		<< "      function drawTile(entry) {\n"
+		<< "        var context = entry.canvas.getContext('2d');\n"
+		<< "        context.setTransform(1, 0, 0, 1, 0, 0);\n"
+		<< "        context.clearRect(0, 0, entry.canvas.width, entry.canvas.height);\n"
+		<< "        var scale = entry.canvas.width / vectorTiles.extent;\n"
+		<< "        context.setTransform(scale, 0, 0, scale, 0, 0);\n"
+		<< "        var highlighted;\n"
+		<< "        entry.features.forEach(function(feature) {\n"
+		<< "          if (feature.index == highlightedRegion) {\n"
+		<< "            highlighted = feature;\n"
+		<< "          } else {\n"
+		<< "            drawFeature(context, feature, scale, false);\n"
+		<< "          }\n"
+		<< "        });\n\n"
+		<< "        if (highlighted) {\n"
+		<< "          drawFeature(context, highlighted, scale, true);\n"
+		<< "        }\n"
+		<< "      }\n\n"
+		<< "      function redrawColorLayer() {\n"
+		<< "        highlightedRegion = -1;\n"
+		<< "        regionLocked = false;\n"
+		<< "        tileEntries.forEach(drawTile);\n"
+		<< "      }\n\n"
+		<< "      // Returns the index of the region at the specified location, or -1 if there is none\n"
+		<< "      function findRegion(latlng) {\n"
+		<< "        var zoom = Math.min(Math.round(map.getZoom()), vectorTiles.maxZoom);\n"
+		<< "        var point = map.project(latlng, zoom);\n"
+		<< "        var size = regionLayer.getTileSize();\n"
+		<< "        var tileCount = Math.pow(2, zoom);\n"
+		<< "        var x = Math.floor(point.x / size.x);\n"
+		<< "        var y = Math.floor(point.y / size.y);\n"
+		<< "        if (y < 0 || y >= tileCount) {\n"
+		<< "          return -1;\n"
+		<< "        }\n\n"
+		<< "        var key = getTileKey(((x % tileCount) + tileCount) % tileCount, y, zoom);\n"
+		<< "        var entry = tileEntries.find(function(e) {\n"
+		<< "          return e.key == key;\n"
+		<< "        });\n"
+		<< "        if (!entry) {\n"
+		<< "          return -1;\n"
+		<< "        }\n\n"
+		<< "        var tileX = (point.x - x * size.x) * vectorTiles.extent / size.x;\n"
+		<< "        var tileY = (point.y - y * size.y) * vectorTiles.extent / size.y;\n"
+		<< "        var context = entry.canvas.getContext('2d');\n"
+		<< "        context.setTransform(1, 0, 0, 1, 0, 0);\n"
+		<< "        for (var i = entry.features.length - 1; i >= 0; i--) {\n"
+		<< "          if (context.isPointInPath(entry.features[i].path, tileX, tileY, 'evenodd')) {\n"
+		<< "            return entry.features[i].index;\n"
+		<< "          }\n"
+		<< "        }\n"
+		<< "        return -1;\n"
+		<< "      }\n\n"
+		<< "      function setHighlightedRegion(region) {\n"
+		<< "        if (region == highlightedRegion) {\n"
+		<< "          return;\n"
+		<< "        }\n\n"
+		<< "        highlightedRegion = region;\n"
+		<< "        tileEntries.forEach(drawTile);\n"
+		<< "        info.update(region >= 0 ? regionProperties[region] : undefined);\n"
+		<< "      }\n\n"
+		<< "      map.on('mousemove', function(e) {\n"
+		<< "        if (!regionLocked) {\n"
+		<< "          setHighlightedRegion(findRegion(e.latlng));\n"
+		<< "        }\n"
+		<< "      });\n\n"
+		<< "      map.on('mouseout', function(e) {\n"
+		<< "        if (!regionLocked) {\n"
+		<< "          setHighlightedRegion(-1);\n"
+		<< "        }\n"
+		<< "      });\n\n"
+		<< "      map.on('click', function(e) {\n"
+		<< "        var region = findRegion(e.latlng);\n"
+		<< "        regionLocked = region >= 0;\n"
+		<< "        setHighlightedRegion(region);\n"
+		<< "        if (regionLocked && intervalHandle) {\n"
+		<< "          clearInterval(intervalHandle);\n"
+		<< "          intervalHandle = null;\n"
+		<< "        }\n"
+		<< "      });\n\n";
+}
+
+bool MapPageGenerator::WriteGeoJSONData(const UString::String& baseOutputFileName,
 	std::vector<ObservationInfo> observationProbabilities)
 {
+	const UString::String fileName(baseOutputFileName + dataExtension);
 	log << "Retrieving county location data" << std::endl;
 	const auto countryCodes(GetCountryCodeList(observationProbabilities));
 	const auto countries(ebi.GetSubRegions(_T("world"), EBirdInterface::RegionType::Country));
@@ -462,6 +875,18 @@ bool MapPageGenerator::WriteGeoJSONData(const UString::String& fileName,
 		countryRegionInfoMap[c] = GetFullCountrySubRegionList(c);
 	}
 
+	std::vector<UString::String> countryNames;
+	for (const auto& c : countryCodes)
+	{
+		const auto countryIt(countryLevelRegionInfoMap.find(c));
+		if (countryIt != countryLevelRegionInfoMap.end())
+			countryNames.push_back(countryIt->second.name);
+	}
+	TopologyBuilder topologyBuilder(geometryLevelLimits);
+	const bool topologyLoaded(LoadTopology(observationProbabilities, countryNames, topologyBuilder));
+	if (!topologyLoaded)
+		kmlLibrary.PreloadCountries(countryNames, kmlPreloadMemoryLimit);
+
 	std::vector<CountyInfo> countyInfo(observationProbabilities.size());
 	ThreadPool pool(std::thread::hardware_concurrency() * 2, 0);
 	auto countyIt(countyInfo.begin());
@@ -478,40 +903,244 @@ bool MapPageGenerator::WriteGeoJSONData(const UString::String& fileName,
 		const auto nameIt(countryRegionInfoMap.find(entry.locationCode.substr(0, 2)));
 		assert(nameIt != countryRegionInfoMap.end());
 		const auto& nameLookupData(nameIt->second);
-		pool.AddJob(std::make_unique<MapJobInfo>(*countyIt, entry, nameLookupData, *this));
+		pool.AddJob(std::make_unique<MapJobInfo>(*countyIt, entry, nameLookupData, !topologyLoaded, *this));
 
 		++countyIt;
 	}
 
 	pool.WaitForAllJobsComplete();
 
-	cJSON* geoJSON;
-	if (!CreateJSONData(countyInfo, kmlReductionLimit, geoJSON))
-		return false;
+	if (!topologyLoaded)
+	{
+		// Missing geometry may be due to a temporary lookup failure, so the topology is only cached when complete
+		bool allGeometryFound(true);
+		for (auto& c : countyInfo)
+		{
+			if (!c.geometry || c.geometry->longitudes.empty())
+				allGeometryFound = false;
+			topologyBuilder.AddRegion(c.geometry ? *c.geometry : BoundaryCache::Region());
+			c.geometry.reset();
+		}
+		topologyBuilder.Build();
+		if (allGeometryFound)
+			SaveTopology(observationProbabilities, countryNames, topologyBuilder);
+	}
 
 	std::ofstream file(fileName);
 	if (!file.is_open() || !file.good())
 	{
 		Cerr << "Failed to open '" << UString::ToStringType(fileName) << "' for output\n";
-		cJSON_Delete(geoJSON);
 		return false;
 	}
 
-	const auto jsonString(cJSON_PrintUnformatted(geoJSON));
-	if (!jsonString)
+	const bool useVectorTiles(vectorTileMaxZoom >= 0);
+	if (!useVectorTiles && !WriteTopologyData(countyInfo, topologyBuilder, file))
+		return false;
+
+	if (!binaryWeekData)
+	{
+		if (!WriteInlineWeekData(countyInfo, file))
+			return false;
+	}
+	else if (!WriteWeekDataFileNames(baseOutputFileName, countyInfo, file))
+		return false;
+
+	if (useVectorTiles)
+		return WriteVectorTileData(baseOutputFileName, countyInfo, topologyBuilder, file);
+	return WriteGeometryLevelData(baseOutputFileName, topologyBuilder, file);
+}
+
+bool MapPageGenerator::WriteWeekDataFileNames(const UString::String& baseOutputFileName, const std::vector<CountyInfo>& observationData, std::ofstream& file)
+{
+	if (!WriteWeekData(baseOutputFileName, observationData))
+		return false;
+
+	JSONWriter writer(file);
+	writer.Raw("var weekDataFiles = ");
+	writer.BeginObject();
+	writer.Key("species");
+	writer.String(UString::ToNarrowString(GetSpeciesFileName(baseOutputFileName)));
+	writer.Key("weeks");
+	writer.BeginArray();
+	for (unsigned int i = 0; i < weekNames.size(); ++i)
+		writer.String(UString::ToNarrowString(GetWeekDataFileName(baseOutputFileName, i)));
+	writer.EndArray();
+	writer.EndObject();
+	writer.Raw(";\n");
+	if (!writer.Flush())
+	{
+		Cerr << "Failed to write week data file names\n";
+		return false;
+	}
+
+	return true;
+}
+
+// Regions are in the same order as the geometries in the topology; species are sorted with the most frequent first
+bool MapPageGenerator::WriteInlineWeekData(const std::vector<CountyInfo>& observationData, std::ofstream& file)
+{
+	JSONWriter writer(file);
+	writer.Raw("var regionWeekData = ");
+	writer.BeginArray();
+	for (const auto& o : observationData)
 	{
-		Cerr << "Failed to generate JSON string\n";
-		cJSON_Delete(geoJSON);
+		writer.BeginArray();
+		for (const auto& w : o.weekInfo)
+			WriteWeekInfo(w, writer);
+		writer.EndArray();
+	}
+	writer.EndArray();
+	writer.Raw(";\n");
+	if (!writer.Flush())
+	{
+		Cerr << "Failed to write week data\n";
 		return false;
 	}
 
-	file << "var regionData = " << jsonString << ";\n";
-	free(jsonString);
-	cJSON_Delete(geoJSON);
+	return true;
+}
+
+void MapPageGenerator::WriteWeekInfo(CountyInfo::WeekInfo weekInfo, JSONWriter& writer)
+{
+	writer.BeginObject();
+	writer.Key("probability");
+	writer.Number(weekInfo.probability * 100.0);
+
+	writer.Key("birds");
+	writer.BeginArray();
+	std::sort(weekInfo.frequencyInfo.begin(), weekInfo.frequencyInfo.end(),
+		[](const EBirdDataProcessor::FrequencyInfo& a, const EBirdDataProcessor::FrequencyInfo& b)
+	{
+		return a.frequency > b.frequency;
+	});
+	for (const auto& m : weekInfo.frequencyInfo)
+	{
+		char frequency[32];
+		std::snprintf(frequency, sizeof(frequency), " (%.2f%%)", m.frequency);
+		writer.String(UString::ToNarrowString(m.species) + frequency);
+	}
+	writer.EndArray();
+
+	writer.EndObject();
+}
+
+// Key includes the library archive hash for each country, so the cache is not used if any boundaries
+// have changed (or if any country is not yet in the library).  Parent region boundaries can change
+// which placemark is matched to a region, so their archive hashes are included, too (zero if not yet
+// downloaded).  Name cleanup also changes which boundaries are matched to each region.
+bool MapPageGenerator::BuildTopologyCacheKey(const std::vector<ObservationInfo>& observationProbabilities,
+	const std::vector<UString::String>& countryNames, GeometryCache::Key& key) const
+{
+	key.region.clear();
+	for (const auto& o : observationProbabilities)
+	{
+		if (!key.region.empty())
+			key.region.push_back(',');
+		key.region.append(UString::ToNarrowString(o.locationCode));
+	}
+
+	key.reductionLimits = geometryLevelLimits;
+	key.precision = geoJSONPrecision;
+	key.sourceHash = BinaryIO::ComputeHash(std::string(1, cleanupKMLLocationNames ? '1' : '0'));
+	for (const auto& c : countryNames)
+	{
+		uint64_t archiveHash;
+		if (!kmlLibrary.GetArchiveHash(c, archiveHash))
+			return false;
+		key.sourceHash = BinaryIO::ComputeHash(reinterpret_cast<const char*>(&archiveHash), sizeof(archiveHash), key.sourceHash);
+
+		uint64_t parentArchiveHash;
+		if (!kmlLibrary.GetParentArchiveHash(c, parentArchiveHash))
+			parentArchiveHash = 0;
+		key.sourceHash = BinaryIO::ComputeHash(reinterpret_cast<const char*>(&parentArchiveHash), sizeof(parentArchiveHash), key.sourceHash);
+	}
+
+	return true;
+}
+
+bool MapPageGenerator::LoadTopology(const std::vector<ObservationInfo>& observationProbabilities,
+	const std::vector<UString::String>& countryNames, TopologyBuilder& topologyBuilder)
+{
+	GeometryCache::Key key;
+	std::ifstream file;
+	if (!BuildTopologyCacheKey(observationProbabilities, countryNames, key) ||
+		!geometryCache.OpenForRead(key, file) || !topologyBuilder.Load(file))
+		return false;
+
+	log << "Loaded region geometry from cache" << std::endl;
+	return true;
+}
+
+// Key is built after the topology, since the library archives may have been updated while looking up the KML
+void MapPageGenerator::SaveTopology(const std::vector<ObservationInfo>& observationProbabilities,
+	const std::vector<UString::String>& countryNames, const TopologyBuilder& topologyBuilder)
+{
+	GeometryCache::Key key;
+	if (!BuildTopologyCacheKey(observationProbabilities, countryNames, key))
+		return;
+
+	std::ofstream file;
+	const bool written(geometryCache.OpenForWrite(key, file) && topologyBuilder.Save(file));
+	if (!geometryCache.FinishWrite(key, file, written))
+		log << "Warning:  Failed to write region geometry to cache" << std::endl;
+}
+
+// Arcs for finer geometry levels are written to separate files, which the page loads only when they are needed
+bool MapPageGenerator::WriteGeometryLevelData(const UString::String& baseOutputFileName,
+	const TopologyBuilder& topologyBuilder, std::ofstream& dataFile) const
+{
+	JSONWriter levelInfoWriter(dataFile);
+	levelInfoWriter.Raw("var geometryLevels = ");
+	levelInfoWriter.BeginObject();
+	levelInfoWriter.Key("limits");
+	levelInfoWriter.BeginArray();
+	for (const auto& limit : geometryLevelLimits)
+		levelInfoWriter.Number(limit);
+	levelInfoWriter.EndArray();
+	levelInfoWriter.Key("files");
+	levelInfoWriter.BeginArray();
+	for (unsigned int i = 0; i < geometryLevelLimits.size(); ++i)
+		levelInfoWriter.String(UString::ToNarrowString(GetGeometryLevelFileName(baseOutputFileName, i)));
+	levelInfoWriter.EndArray();
+	levelInfoWriter.EndObject();
+	levelInfoWriter.Raw(";\n");
+	if (!levelInfoWriter.Flush())
+	{
+		Cerr << "Failed to write geometry level data\n";
+		return false;
+	}
+
+	for (unsigned int i = 0; i + 1 < geometryLevelLimits.size(); ++i)
+	{
+		const UString::String fileName(GetGeometryLevelFileName(baseOutputFileName, i));
+		std::ofstream file(fileName);
+		if (!file.is_open() || !file.good())
+		{
+			Cerr << "Failed to open '" << UString::ToStringType(fileName) << "' for output\n";
+			return false;
+		}
+
+		JSONWriter writer(file);
+		writer.Raw("loadGeometryLevel(" + std::to_string(i) + ", ");
+		topologyBuilder.WriteArcs(i, writer);
+		writer.Raw(");\n");
+		if (!writer.Flush())
+		{
+			Cerr << "Failed to write to '" << UString::ToStringType(fileName) << "'\n";
+			return false;
+		}
+	}
 
 	return true;
 }
 
+UString::String MapPageGenerator::GetGeometryLevelFileName(const UString::String& baseOutputFileName, const unsigned int& level)
+{
+	UString::OStringStream ss;
+	ss << baseOutputFileName << "_geometry" << level << dataExtension;
+	return ss.str();
+}
+
 UString::String MapPageGenerator::ForceTrailingSlash(const UString::String& path)
 {
 #ifdef _MSW_
@@ -525,127 +1154,250 @@ UString::String MapPageGenerator::ForceTrailingSlash(const UString::String& path
 	return path + slash;
 }
 
-bool MapPageGenerator::CreateJSONData(const std::vector<CountyInfo>& observationData, const double& kmlReductionLimit, cJSON*& geoJSON)
+// Region boundaries are written as a topology (shared borders stored once as arcs referenced by each
+// region), so neighboring regions still meet exactly after the borders are reduced.  Records are
+// streamed to the file as they are generated, so the document is never held in memory.
+bool MapPageGenerator::WriteTopologyData(const std::vector<CountyInfo>& observationData,
+	const TopologyBuilder& topologyBuilder, std::ofstream& file) const
 {
-	geoJSON = cJSON_CreateObject();
-	if (!geoJSON)
+	assert(!geometryLevelLimits.empty());
+	JSONWriter writer(file);
+	writer.Raw("var regionTopology = ");
+	writer.BeginObject();
+	writer.Key("type");
+	writer.String("Topology");
+	writer.Key("arcs");
+	topologyBuilder.WriteArcs(static_cast<unsigned int>(geometryLevelLimits.size() - 1), writer);
+
+	writer.Key("objects");
+	writer.BeginObject();
+	writer.Key("regions");
+	writer.BeginObject();
+	writer.Key("type");
+	writer.String("GeometryCollection");
+	writer.Key("geometries");
+	writer.BeginArray();
+
+	for (std::size_t i = 0; i < observationData.size(); ++i)
 	{
-		Cerr << "Failed to create root JSON object for writing\n";
-		return false;
+		writer.BeginObject();
+		topologyBuilder.WriteGeometry(i, writer);
+		writer.Key("properties");
+		WriteObservationRecord(observationData[i], writer);
+		writer.EndObject();
 	}
 
-	cJSON_AddStringToObject(geoJSON, "type", "FeatureCollection");
+	writer.EndArray();
+	writer.EndObject();
+	writer.EndObject();
+	writer.EndObject();
+	writer.Raw(";\n");
 
-	auto regions(cJSON_CreateArray());
-	if (!regions)
+	if (!writer.Flush())
 	{
-		Cerr << "Failed to create regions JSON object\n";
+		Cerr << "Failed to write topology data\n";
 		return false;
 	}
 
-	cJSON_AddItemToObject(geoJSON, "features", regions);
+	return true;
+}
+
+// Tiles are written to a directory next to the page; any tiles from a previous run are removed first
+// so regions which no longer exist are not drawn
+bool MapPageGenerator::WriteVectorTileData(const UString::String& baseOutputFileName, const std::vector<CountyInfo>& observationData,
+	const TopologyBuilder& topologyBuilder, std::ofstream& file) const
+{
+	assert(vectorTileMaxZoom >= 0);
+	const UString::String tilePath(GetVectorTilePath(baseOutputFileName));
 
+	JSONWriter writer(file);
+	writer.Raw("var regionProperties = ");
+	writer.BeginArray();
 	for (const auto& o : observationData)
+		WriteObservationRecord(o, writer);
+	writer.EndArray();
+	writer.Raw(";\n");
+
+	writer.Raw("var vectorTiles = ");
+	writer.BeginObject();
+	writer.Key("url");
+	writer.String(UString::ToNarrowString(tilePath) + "/{z}/{x}/{y}.json");
+	writer.Key("maxZoom");
+	writer.Integer(vectorTileMaxZoom);
+	writer.Key("extent");
+	writer.Integer(VectorTileBuilder::extent);
+	writer.EndObject();
+	writer.Raw(";\n");
+	if (!writer.Flush())
 	{
-		auto r(cJSON_CreateObject());
-		if (!r)
-		{
-			Cerr << "Failed to create region JSON object\n";
-			return false;
-		}
+		Cerr << "Failed to write region properties\n";
+		return false;
+	}
 
-		cJSON_AddItemToArray(regions, r);
-		if (!BuildObservationRecord(o, kmlReductionLimit, r))
-			return false;
+	std::error_code error;
+	std::filesystem::remove_all(std::filesystem::path(tilePath), error);
+	if (error)
+	{
+		Cerr << "Failed to remove existing tiles from '" << tilePath << "'\n";
+		return false;
 	}
 
-	return true;
+	Cout << "Writing vector tiles" << std::endl;
+	const VectorTileBuilder tileBuilder(topologyBuilder, geometryLevelLimits);
+	return tileBuilder.WriteTiles(UString::ToNarrowString(tilePath), static_cast<unsigned int>(vectorTileMaxZoom));
 }
 
-bool MapPageGenerator::BuildObservationRecord(const CountyInfo& observation, const double& kmlReductionLimit, cJSON* json)
+UString::String MapPageGenerator::GetVectorTilePath(const UString::String& baseOutputFileName)
 {
-	cJSON_AddStringToObject(json, "type", "Feature");
+	return baseOutputFileName + _T("_tiles");
+}
 
-	auto observationData(cJSON_CreateObject());
-	if (!observationData)
+void MapPageGenerator::WriteObservationRecord(const CountyInfo& observation, JSONWriter& writer)
+{
+	writer.BeginObject();
+	writer.Key("name");
+	writer.String(UString::ToNarrowString(observation.name));
+	writer.Key("country");
+	writer.String(UString::ToNarrowString(observation.country));
+	writer.Key("state");
+	writer.String(UString::ToNarrowString(observation.state));
+	writer.Key("county");
+	writer.String(UString::ToNarrowString(observation.county));
+	writer.EndObject();
+}
+
+// Species names are written once, with a separate file for each week, so the page loads only the weeks
+// which are viewed.  All values are little-endian.
+// Species file:
+//   uint32 version, species count
+//   species names (uint16 length followed by UTF-8 bytes)
+// Week files:
+//   uint32 version, region count
+//   probability for each region (uint8, 255 = 100 %; nonzero probabilities are stored as at least 1, since 0 is drawn as no data)
+//   number of species for each region (varint)
+//   species index deltas for each region, with indices ascending (varint)
+//   species frequencies in the same order as the indices (uint16, units of 0.01 %)
+// Regions are in the same order as the geometries in the topology.
+bool MapPageGenerator::WriteWeekData(const UString::String& baseOutputFileName, const std::vector<CountyInfo>& observationData)
+{
+	std::map<UString::String, uint32_t> speciesIndices;
+	for (const auto& o : observationData)
 	{
-		Cerr << "Failed to create observation data JSON object\n";
-		return false;
+		for (const auto& w : o.weekInfo)
+		{
+			for (const auto& f : w.frequencyInfo)
+				speciesIndices.insert(std::make_pair(f.species, 0));
+		}
 	}
 
-	cJSON_AddItemToObject(json, "properties", observationData);
+	uint32_t nextIndex(0);
+	for (auto& s : speciesIndices)
+		s.second = nextIndex++;
 
-	KMLToGeoJSONConverter kmlToGeoJson(UString::ToNarrowString(observation.geometryKML), kmlReductionLimit);
-	auto geometry(kmlToGeoJson.GetGeoJSON());
-	if (!geometry)
-		return false;
-
-	cJSON_AddItemToObject(json, "geometry", geometry);
-
-	cJSON_AddStringToObject(observationData, "name", UString::ToNarrowString(observation.name).c_str());
-	cJSON_AddStringToObject(observationData, "country", UString::ToNarrowString(observation.country).c_str());
-	cJSON_AddStringToObject(observationData, "state", UString::ToNarrowString(observation.state).c_str());
-	cJSON_AddStringToObject(observationData, "county", UString::ToNarrowString(observation.county).c_str());
-
-	auto weekData(cJSON_CreateArray());
-	if (!weekData)
+	std::string speciesData;
+	AppendUInt32(weekDataVersion, speciesData);
+	AppendUInt32(static_cast<uint32_t>(speciesIndices.size()), speciesData);
+	for (const auto& s : speciesIndices)
 	{
-		Cerr << "Failed to create week data JSON object\n";
-		return false;
+		const auto name(UString::ToNarrowString(s.first).substr(0, std::numeric_limits<uint16_t>::max()));
+		AppendUInt16(static_cast<uint16_t>(name.length()), speciesData);
+		speciesData.append(name);
 	}
 
-	cJSON_AddItemToObject(observationData, "weekData", weekData);
+	if (!WriteBinaryFile(GetSpeciesFileName(baseOutputFileName), { &speciesData }))
+		return false;
 
-	for (const auto& m : observation.weekInfo)
+	std::vector<std::pair<uint32_t, uint16_t>> speciesList;// first is species index, second is frequency
+	for (unsigned int week = 0; week < weekNames.size(); ++week)
 	{
-		cJSON* week(cJSON_CreateObject());
-		if (!week)
+		std::string header, probabilities, speciesCounts, speciesDeltas, frequencies;
+		AppendUInt32(weekDataVersion, header);
+		AppendUInt32(static_cast<uint32_t>(observationData.size()), header);
+		for (const auto& o : observationData)
 		{
-			Cerr << "Failed to create week JSON object\n";
-			return false;
+			const auto& w(o.weekInfo[week]);
+			const double probability(std::min(std::max(w.probability, 0.0), 1.0));
+			probabilities.push_back(static_cast<char>(probability > 0.0 ? std::max(std::lround(probability * 255.0), 1L) : 0L));
+
+			speciesList.clear();
+			for (const auto& f : w.frequencyInfo)
+				speciesList.push_back(std::make_pair(speciesIndices[f.species],
+					static_cast<uint16_t>(std::lround(std::min(std::max(f.frequency, 0.0), 100.0) * 100.0))));
+			std::sort(speciesList.begin(), speciesList.end());
+
+			AppendVarint(static_cast<uint32_t>(speciesList.size()), speciesCounts);
+			uint32_t previousIndex(0);
+			for (const auto& s : speciesList)
+			{
+				AppendVarint(s.first - previousIndex, speciesDeltas);
+				AppendUInt16(s.second, frequencies);
+				previousIndex = s.first;
+			}
 		}
 
-		cJSON_AddItemToArray(weekData, week);
-		if (!BuildWeekInfo(m, week))
+		if (!WriteBinaryFile(GetWeekDataFileName(baseOutputFileName, week), { &header, &probabilities, &speciesCounts, &speciesDeltas, &frequencies }))
 			return false;
 	}
 
 	return true;
 }
 
-bool MapPageGenerator::BuildWeekInfo(CountyInfo::WeekInfo weekInfo, cJSON* json)
+bool MapPageGenerator::WriteBinaryFile(const UString::String& fileName, const std::vector<const std::string*>& sections)
 {
-	cJSON_AddNumberToObject(json, "probability", weekInfo.probability * 100.0);
-	auto speciesList(cJSON_CreateArray());
-	if (!speciesList)
+	std::ofstream file(fileName, std::ios::binary);
+	if (!file.is_open() || !file.good())
 	{
-		Cerr << "Failed to create species list JSON object\n";
+		Cerr << "Failed to open '" << UString::ToStringType(fileName) << "' for output\n";
 		return false;
 	}
 
-	cJSON_AddItemToObject(json, "birds", speciesList);
-	std::sort(weekInfo.frequencyInfo.begin(), weekInfo.frequencyInfo.end(),
-		[](const EBirdDataProcessor::FrequencyInfo& a, const EBirdDataProcessor::FrequencyInfo& b)
-	{
-		return a.frequency > b.frequency;
-	});
-	for (const auto& m : weekInfo.frequencyInfo)
-	{
-		std::ostringstream ss;
-		ss << UString::ToNarrowString(m.species) << " (" << std::fixed << std::setprecision(2) << m.frequency << "%)";
-		auto species(cJSON_CreateString(ss.str().c_str()));
-		if (!species)
-		{
-			Cerr << "Failed to create species JSON object\n";
-			return false;
-		}
+	for (const auto& section : sections)
+		file.write(section->data(), section->size());
 
-		cJSON_AddItemToArray(speciesList, species);
+	if (!file.good())
+	{
+		Cerr << "Failed to write to '" << UString::ToStringType(fileName) << "'\n";
+		return false;
 	}
 
 	return true;
 }
 
+void MapPageGenerator::AppendUInt16(const uint16_t& value, std::string& data)
+{
+	data.push_back(static_cast<char>(value & 0xFF));
+	data.push_back(static_cast<char>(value >> 8));
+}
+
+void MapPageGenerator::AppendUInt32(const uint32_t& value, std::string& data)
+{
+	for (unsigned int i = 0; i < 4; ++i)
+		data.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+}
+
+// Seven bits per byte, least significant first, with the high bit set on all but the last byte
+void MapPageGenerator::AppendVarint(uint32_t value, std::string& data)
+{
+	while (value >= 0x80)
+	{
+		data.push_back(static_cast<char>((value & 0x7F) | 0x80));
+		value >>= 7;
+	}
+	data.push_back(static_cast<char>(value));
+}
+
+UString::String MapPageGenerator::GetSpeciesFileName(const UString::String& baseOutputFileName)
+{
+	return baseOutputFileName + _T("_species") + binaryExtension;
+}
+
+UString::String MapPageGenerator::GetWeekDataFileName(const UString::String& baseOutputFileName, const unsigned int& week)
+{
+	UString::OStringStream ss;
+	ss << baseOutputFileName << "_week" << week << binaryExtension;
+	return ss.str();
+}
+
 std::vector<UString::String> MapPageGenerator::GetCountryCodeList(const std::vector<ObservationInfo>& observationProbabilities)
 {
 	std::set<UString::String> codes;
@@ -703,8 +1455,8 @@ void MapPageGenerator::LookupAndAssignKML(CountyInfo& data)
 	UString::String countryName, stateName;
 	LookupEBirdRegionNames(data.country, data.state, countryName, stateName);
 	assert(!countryName.empty());
-	data.geometryKML = kmlLibrary.GetKML(countryName, stateName, data.county);
-	if (data.geometryKML.empty())
+	data.geometry = kmlLibrary.GetGeometry(countryName, stateName, data.county);
+	if (!data.geometry)
 	{
 
 		log << "\rWarning:  Geometry not found for '" << data.code << "\' (" << countryName;
@@ -818,7 +1570,8 @@ void MapPageGenerator::MapJobInfo::DoJob()
 		mpg.log << "No name found for region " << frequencyInfo.locationCode << std::endl;
 		//assert(!info.country.empty() && !info.name.empty() && !info.code.empty());
 	}
-	mpg.LookupAndAssignKML(info);
+	if (lookupKML)
+		mpg.LookupAndAssignKML(info);
 }
 
 UString::String MapPageGenerator::BuildSpeciesInfoString(const std::vector<EBirdDataProcessor::FrequencyInfo>& info)
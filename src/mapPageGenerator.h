@@ -11,6 +11,9 @@
 #include "threadPool.h"
 #include "throttledSection.h"
 #include "kmlLibraryManager.h"
+#include "topologyBuilder.h"
+#include "geometryCache.h"
+#include "jsonWriter.h"
 #include "utilities/uString.h"
 #include "logging/combinedLogger.h"
 
@@ -18,6 +21,7 @@
 #include <map>
 #include <unordered_map>
 #include <shared_mutex>
+#include <cstdint>
 
 class MapPageGenerator
 {
@@ -32,6 +36,10 @@ public:
 private:
 	static const UString::String htmlExtension;
 	static const UString::String dataExtension;
+	static const UString::String binaryExtension;
+	static const uint32_t weekDataVersion;
+	static const unsigned int geometryLevelCount;
+	static const double geometryLevelScale;
 
 	CombinedLogger<typename std::basic_ostream<UString::String::value_type>> log;
 
@@ -67,11 +75,17 @@ private:
 	void AddRegionCodesToMap(const UString::String& parentCode, const EBirdInterface::RegionType& regionType);
 
 	bool WriteHTML(const UString::String& fileName, const UString::String& dataFileName) const;
-	bool WriteGeoJSONData(const UString::String& fileName, std::vector<ObservationInfo> observationProbabilities);
+	bool WriteGeoJSONData(const UString::String& baseOutputFileName, std::vector<ObservationInfo> observationProbabilities);
+	bool WriteGeometryLevelData(const UString::String& baseOutputFileName, const TopologyBuilder& topologyBuilder, std::ofstream& dataFile) const;
+	static UString::String GetGeometryLevelFileName(const UString::String& baseOutputFileName, const unsigned int& level);
 
 	static void WriteHeadSection(UString::OStream& f);
-	static void WriteBody(UString::OStream& f, const UString::String& dataFileName);
-	static void WriteScripts(UString::OStream& f);
+	static void WriteBody(UString::OStream& f, const UString::String& dataFileName, const bool& useVectorTiles, const bool& binaryWeekData);
+	static void WriteScripts(UString::OStream& f, const bool& useVectorTiles, const bool& binaryWeekData);
+	static void WriteBinaryWeekDataScripts(UString::OStream& f);
+	static void WriteInlineWeekDataScripts(UString::OStream& f);
+	static void WriteTopologyScripts(UString::OStream& f);
+	static void WriteVectorTileScripts(UString::OStream& f);
 
 	struct CountyInfo
 	{
@@ -81,7 +95,7 @@ private:
 		UString::String country;
 		UString::String code;
 
-		UString::String geometryKML;
+		KMLLibraryManager::RegionPointer geometry;
 
 		struct WeekInfo
 		{
@@ -92,9 +106,26 @@ private:
 		std::array<WeekInfo, 48> weekInfo;
 	};
 
-	static bool CreateJSONData(const std::vector<CountyInfo>& observationData, const double& kmlReductionLimit, cJSON*& geoJSON);
-	static bool BuildObservationRecord(const CountyInfo& observation, const double& kmlReductionLimit, cJSON* json);
-	static bool BuildWeekInfo(CountyInfo::WeekInfo weekInfo, cJSON* json);
+	// Topology uses the coarsest geometry; arcs for the finer levels are written separately
+	bool WriteTopologyData(const std::vector<CountyInfo>& observationData, const TopologyBuilder& topologyBuilder, std::ofstream& file) const;
+	static void WriteObservationRecord(const CountyInfo& observation, JSONWriter& writer);
+
+	// Region properties are written to the page and geometry is written as a tile pyramid
+	bool WriteVectorTileData(const UString::String& baseOutputFileName, const std::vector<CountyInfo>& observationData,
+		const TopologyBuilder& topologyBuilder, std::ofstream& file) const;
+	static UString::String GetVectorTilePath(const UString::String& baseOutputFileName);
+
+	// Week data is written either to the page data (as JSON), or to separate binary files which the page fetches
+	static bool WriteInlineWeekData(const std::vector<CountyInfo>& observationData, std::ofstream& file);
+	static void WriteWeekInfo(CountyInfo::WeekInfo weekInfo, JSONWriter& writer);
+	static bool WriteWeekDataFileNames(const UString::String& baseOutputFileName, const std::vector<CountyInfo>& observationData, std::ofstream& file);
+	static bool WriteWeekData(const UString::String& baseOutputFileName, const std::vector<CountyInfo>& observationData);
+	static bool WriteBinaryFile(const UString::String& fileName, const std::vector<const std::string*>& sections);
+	static UString::String GetSpeciesFileName(const UString::String& baseOutputFileName);
+	static UString::String GetWeekDataFileName(const UString::String& baseOutputFileName, const unsigned int& week);
+	static void AppendUInt16(const uint16_t& value, std::string& data);
+	static void AppendUInt32(const uint32_t& value, std::string& data);
+	static void AppendVarint(uint32_t value, std::string& data);
 
 	static UString::String ForceTrailingSlash(const UString::String& path);
 
@@ -105,7 +136,23 @@ private:
 	};
 
 	KMLLibraryManager kmlLibrary;
-	const double kmlReductionLimit;
+	const std::vector<double> geometryLevelLimits;// [km] finest first
+	static std::vector<double> BuildGeometryLevelLimits(const double& kmlReductionLimit);
+	const uint64_t kmlPreloadMemoryLimit;// [bytes]
+	const int vectorTileMaxZoom;// Negative to embed the geometry in the page (as a topology) instead of writing vector tiles
+	const bool binaryWeekData;
+	const int geoJSONPrecision;
+	const bool cleanupKMLLocationNames;
+
+	// Built topology is cached for each set of regions, so regenerating the page (i.e. after the
+	// frequency data is updated) skips the KML lookup, parsing and reduction entirely
+	const GeometryCache geometryCache;
+	bool BuildTopologyCacheKey(const std::vector<ObservationInfo>& observationProbabilities,
+		const std::vector<UString::String>& countryNames, GeometryCache::Key& key) const;
+	bool LoadTopology(const std::vector<ObservationInfo>& observationProbabilities,
+		const std::vector<UString::String>& countryNames, TopologyBuilder& topologyBuilder);
+	void SaveTopology(const std::vector<ObservationInfo>& observationProbabilities,
+		const std::vector<UString::String>& countryNames, const TopologyBuilder& topologyBuilder);
 
 	void LookupAndAssignKML(CountyInfo& data);
 
@@ -118,12 +165,13 @@ private:
 	{
 		MapJobInfo() = default;
 		MapJobInfo(CountyInfo& info, const ObservationInfo& frequencyInfo,
-			const std::vector<EBirdInterface::RegionInfo>& regionNames, MapPageGenerator& mpg)
-			: info(info), frequencyInfo(frequencyInfo), regionNames(regionNames), mpg(mpg) {}
+			const std::vector<EBirdInterface::RegionInfo>& regionNames, const bool& lookupKML, MapPageGenerator& mpg)
+			: info(info), frequencyInfo(frequencyInfo), regionNames(regionNames), lookupKML(lookupKML), mpg(mpg) {}
 
 		CountyInfo& info;
 		const ObservationInfo& frequencyInfo;
 		const std::vector<EBirdInterface::RegionInfo>& regionNames;
+		const bool lookupKML;// Not needed when the geometry was loaded from the cache
 		MapPageGenerator& mpg;
 
 		void DoJob() override;
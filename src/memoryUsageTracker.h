@@ -0,0 +1,117 @@
+// File:  memoryUsageTracker.h
+// Date:  10/18/2026
+// Auth:  K. Loux
+// Desc:  Tracks memory used by groups of cached items in least-recently-used order.
+
+#ifndef MEMORY_USAGE_TRACKER_H_
+#define MEMORY_USAGE_TRACKER_H_
+
+// Standard C++ headers
+#include <list>
+#include <map>
+#include <vector>
+#include <mutex>
+#include <cstdint>
+
+// Only tracks usage - removing the items themselves is left to the owner of the cache.
+// Methods are thread-safe so access can be recorded while the owner holds only a shared lock.
+template<typename KeyType>
+class MemoryUsageTracker
+{
+public:
+	void Add(const KeyType& key, const uint64_t& bytes);// Adds to existing entry, if present
+	void Remove(const KeyType& key);
+	void Touch(const KeyType& key);// Marks key as most recently used
+
+	uint64_t GetTotalBytes() const;
+
+	// Returns keys (least-recently-used first) which must be removed to bring usage within the limit.
+	// The key in keep is never selected.
+	std::vector<KeyType> SelectForEviction(const uint64_t& limit, const KeyType& keep) const;
+
+private:
+	typedef std::list<KeyType> OrderList;
+	OrderList order;// Most recently used first
+
+	struct Entry
+	{
+		uint64_t bytes;
+		typename OrderList::iterator position;
+	};
+
+	std::map<KeyType, Entry> entries;
+	uint64_t totalBytes = 0;
+
+	mutable std::mutex mutex;
+};
+
+template<typename KeyType>
+void MemoryUsageTracker<KeyType>::Add(const KeyType& key, const uint64_t& bytes)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	auto it(entries.find(key));
+	if (it == entries.end())
+	{
+		order.push_front(key);
+		Entry entry;
+		entry.bytes = bytes;
+		entry.position = order.begin();
+		entries.insert(std::make_pair(key, entry));
+	}
+	else
+	{
+		it->second.bytes += bytes;
+		order.splice(order.begin(), order, it->second.position);
+	}
+
+	totalBytes += bytes;
+}
+
+template<typename KeyType>
+void MemoryUsageTracker<KeyType>::Remove(const KeyType& key)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	auto it(entries.find(key));
+	if (it == entries.end())
+		return;
+
+	totalBytes -= it->second.bytes;
+	order.erase(it->second.position);
+	entries.erase(it);
+}
+
+template<typename KeyType>
+void MemoryUsageTracker<KeyType>::Touch(const KeyType& key)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	auto it(entries.find(key));
+	if (it != entries.end())
+		order.splice(order.begin(), order, it->second.position);
+}
+
+template<typename KeyType>
+uint64_t MemoryUsageTracker<KeyType>::GetTotalBytes() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return totalBytes;
+}
+
+template<typename KeyType>
+std::vector<KeyType> MemoryUsageTracker<KeyType>::SelectForEviction(const uint64_t& limit, const KeyType& keep) const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	std::vector<KeyType> keys;
+	uint64_t remainingBytes(totalBytes);
+	for (auto it = order.rbegin(); it != order.rend() && remainingBytes > limit; ++it)
+	{
+		if (*it == keep)
+			continue;
+
+		keys.push_back(*it);
+		remainingBytes -= entries.find(*it)->second.bytes;
+	}
+
+	return keys;
+}
+
+#endif// MEMORY_USAGE_TRACKER_H_
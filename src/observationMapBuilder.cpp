@@ -5,7 +5,20 @@
 
 // Local headers
 #include "observationMapBuilder.h"
-#include "kmlToGeoJSONConverter.h"
+#include "geometryCache.h"
+#include "binaryIO.h"
+#include "jsonWriter.h"
+
+// Standard C++ headers
+#include <filesystem>
+#include <algorithm>
+#include <map>
+#include <cmath>
+#include <cassert>
+
+const unsigned int ObservationMapBuilder::maxClusterZoom(16);
+const double ObservationMapBuilder::clusterCellSize(64.0);
+const std::size_t ObservationMapBuilder::maxChecklistsPerChunk(5000);
 
 bool ObservationMapBuilder::Build(const UString::String& outputFileName, const UString::String& kmlBoundaryFileName,
 	const std::vector<EBirdDatasetInterface::MapInfo>& mapInfo) const
@@ -23,7 +36,7 @@ bool ObservationMapBuilder::Build(const UString::String& outputFileName, const U
 	const UString::String jsFileName(outputFileName.substr(0, lastDot) + _T(".js"));
 	const UString::String htmlFileName(outputFileName.substr(0, lastDot) + _T(".html"));
 	
-	if (!WriteDataFile(jsFileName, kml, mapInfo))
+	if (!WriteDataFile(jsFileName, kml, kmlBoundaryFileName, mapInfo))
 		return false;
 		
 	if (!WriteHTMLFile(htmlFileName))
@@ -32,9 +45,9 @@ bool ObservationMapBuilder::Build(const UString::String& outputFileName, const U
 	return true;
 }
 
-bool ObservationMapBuilder::WriteDataFile(const UString::String& fileName, const UString::String& kml, const std::vector<EBirdDatasetInterface::MapInfo>& mapInfo) const
+bool ObservationMapBuilder::WriteDataFile(const UString::String& fileName, const UString::String& kml, const UString::String& kmlFileName, const std::vector<EBirdDatasetInterface::MapInfo>& mapInfo) const
 {
-	UString::OFStream file(fileName);
+	std::ofstream file(fileName);
 	if (!file.is_open() || !file.good())
 	{
 		Cerr << "Failed to open '" << fileName << "' for output\n";
@@ -43,7 +56,7 @@ bool ObservationMapBuilder::WriteDataFile(const UString::String& fileName, const
 	
 	const double& kmlReductionLimit(0.0);// 0.0 == don't do any reduction
 	cJSON* geoJSON;
-	if (!CreateJSONData(kml, kmlReductionLimit, geoJSON))
+	if (!CreateJSONData(kml, kmlFileName, kmlReductionLimit, geoJSON))
 		return false;
 
 	const auto jsonString(cJSON_PrintUnformatted(geoJSON));
@@ -58,26 +71,33 @@ bool ObservationMapBuilder::WriteDataFile(const UString::String& fileName, const
 	free(jsonString);
 	cJSON_Delete(geoJSON);
 
-	cJSON* mapInfoJSON;
-	if (!CreateJSONData(mapInfo, mapInfoJSON))
-		return false;
-		
-	const auto dataJSONString(cJSON_PrintUnformatted(mapInfoJSON));
-	if (!dataJSONString)
+	const auto locations(SortLocations(mapInfo));
+	const auto chunkStarts(AssignChunks(locations));
+
+	JSONWriter writer(file);
+	writer.Raw("var locationData = ");
+	writer.BeginObject();
+	writer.Key("clusters");
+	WriteClusters(locations, writer);
+	writer.Key("locations");
+	WriteLocations(locations, chunkStarts, writer);
+	writer.Key("chunkFiles");
+	writer.BeginArray();
+	for (std::size_t i = 0; i + 1 < chunkStarts.size(); ++i)
+		writer.String(UString::ToNarrowString(GetChunkFileName(fileName, i)));
+	writer.EndArray();
+	writer.EndObject();
+	writer.Raw(";\n");
+	if (!writer.Flush())
 	{
-		Cerr << "Failed to generate map info JSON string\n";
-		cJSON_Delete(mapInfoJSON);
+		Cerr << "Failed to write location data\n";
 		return false;
 	}
 	
-	file << "var mapInfo = " << dataJSONString << ";\n";
-	free(dataJSONString);
-	cJSON_Delete(mapInfoJSON);
-	
-	return true;
+	return WriteChecklistChunks(fileName, locations, chunkStarts);
 }
 
-bool ObservationMapBuilder::CreateJSONData(const UString::String& kml, const double& kmlReductionLimit, cJSON*& geoJSON)
+bool ObservationMapBuilder::CreateJSONData(const UString::String& kml, const UString::String& kmlFileName, const double& kmlReductionLimit, cJSON*& geoJSON)
 {
 	geoJSON = cJSON_CreateObject();
 	if (!geoJSON)
@@ -105,13 +125,13 @@ bool ObservationMapBuilder::CreateJSONData(const UString::String& kml, const dou
 	}
 
 	cJSON_AddItemToArray(regions, r);
-	if (!BuildGeometryJSON(kml, kmlReductionLimit, r))
+	if (!BuildGeometryJSON(kml, kmlFileName, kmlReductionLimit, r))
 		return false;
 
 	return true;
 }
 
-bool ObservationMapBuilder::BuildGeometryJSON(const UString::String& kml, const double& kmlReductionLimit, cJSON* json)
+bool ObservationMapBuilder::BuildGeometryJSON(const UString::String& kml, const UString::String& kmlFileName, const double& kmlReductionLimit, cJSON* json)
 {
 	cJSON_AddStringToObject(json, "type", "Feature");
 
@@ -124,8 +144,7 @@ bool ObservationMapBuilder::BuildGeometryJSON(const UString::String& kml, const
 
 	cJSON_AddItemToObject(json, "properties", geometryData);
 
-	KMLToGeoJSONConverter kmlToGeoJson(UString::ToNarrowString(kml), kmlReductionLimit);
-	auto geometry(kmlToGeoJson.GetGeoJSON());
+	auto geometry(KMLToGeoJSONConverter::BuildGeoJSON(GetBoundaryPolygons(kml, kmlFileName, kmlReductionLimit)));
 	if (!geometry)
 		return false;
 
@@ -133,121 +152,273 @@ bool ObservationMapBuilder::BuildGeometryJSON(const UString::String& kml, const
 	return true;
 }
 
-bool ObservationMapBuilder::CreateJSONData(const std::vector<EBirdDatasetInterface::MapInfo>& mapInfo, cJSON*& mapJSON)
+// Converted boundary is cached next to the boundary file, so the KML is only parsed again when it changes
+std::vector<KMLToGeoJSONConverter::Polygon> ObservationMapBuilder::GetBoundaryPolygons(const UString::String& kml, const UString::String& kmlFileName, const double& kmlReductionLimit)
 {
-	mapJSON = cJSON_CreateObject();
-	if (!mapJSON)
+	const std::string narrowKML(UString::ToNarrowString(kml));
+	if (kmlFileName.empty())
+		return KMLToGeoJSONConverter(narrowKML, kmlReductionLimit).GetPolygons();
+
+	const std::filesystem::path kmlPath(kmlFileName);
+	const GeometryCache cache(UString::ToStringType(kmlPath.parent_path().string()));
+	GeometryCache::Key key;
+	key.region = kmlPath.filename().string();
+	key.reductionLimits.push_back(kmlReductionLimit);
+	key.precision = -1;
+	key.sourceHash = BinaryIO::ComputeHash(narrowKML);
+
+	std::vector<KMLToGeoJSONConverter::Polygon> polygons;
+	std::ifstream inFile;
+	if (cache.OpenForRead(key, inFile) && GeometryCache::ReadPolygons(inFile, polygons))
+		return polygons;
+
+	polygons = KMLToGeoJSONConverter(narrowKML, kmlReductionLimit).GetPolygons();
+	std::ofstream outFile;
+	const bool written(cache.OpenForWrite(key, outFile) && GeometryCache::WritePolygons(outFile, polygons));
+	if (!cache.FinishWrite(key, outFile, written))
+		Cerr << "Warning:  Failed to write boundary geometry to cache\n";
+
+	return polygons;
+}
+
+// Locations are stored in spatial (Morton) order, so nearby locations are usually in the same checklist chunk
+std::vector<const EBirdDatasetInterface::MapInfo*> ObservationMapBuilder::SortLocations(const std::vector<EBirdDatasetInterface::MapInfo>& mapInfo)
+{
+	std::vector<std::pair<uint32_t, const EBirdDatasetInterface::MapInfo*>> keyedLocations;
+	keyedLocations.reserve(mapInfo.size());
+	for (const auto& m : mapInfo)
 	{
-		Cerr << "Failed to create map JSON object for writing\n";
-		return false;
+		const auto p(Project(m.latitude, m.longitude));
+		const auto x(static_cast<uint32_t>(std::min(65535.0, std::max(0.0, p.x * 256.0))));
+		const auto y(static_cast<uint32_t>(std::min(65535.0, std::max(0.0, p.y * 256.0))));
+
+		uint32_t key(0);
+		for (unsigned int bit = 0; bit < 16; ++bit)
+			key |= (((x >> bit) & 1) << (2 * bit)) | (((y >> bit) & 1) << (2 * bit + 1));
+		keyedLocations.push_back(std::make_pair(key, &m));
 	}
 
-	cJSON_AddStringToObject(mapJSON, "type", "FeatureCollection");
+	std::stable_sort(keyedLocations.begin(), keyedLocations.end(),
+		[](const std::pair<uint32_t, const EBirdDatasetInterface::MapInfo*>& a, const std::pair<uint32_t, const EBirdDatasetInterface::MapInfo*>& b)
+	{
+		return a.first < b.first;
+	});
+
+	std::vector<const EBirdDatasetInterface::MapInfo*> locations(keyedLocations.size());
+	for (std::size_t i = 0; i < keyedLocations.size(); ++i)
+		locations[i] = keyedLocations[i].second;
+	return locations;
+}
+
+// Web mercator projection onto the zoom level zero world (256 x 256 pixels)
+Point ObservationMapBuilder::Project(const double& latitude, const double& longitude)
+{
+	const double maxLatitude(85.0511287798);// [deg]
+	const double pi(4.0 * std::atan(1.0));
+	const double clampedLatitude(std::min(maxLatitude, std::max(-maxLatitude, latitude)) * pi / 180.0);
+
+	Point p;
+	p.x = (longitude + 180.0) / 360.0 * 256.0;
+	p.y = (0.5 - std::log(std::tan(0.25 * pi + 0.5 * clampedLatitude)) / (2.0 * pi)) * 256.0;
+	return p;
+}
 
-	auto locations(cJSON_CreateArray());
-	if (!locations)
+// Returns index of first location in each chunk, followed by the location count.  Chunks are closed once
+// they contain maxChecklistsPerChunk checklists (a location with more checklists gets a chunk of its own).
+std::vector<std::size_t> ObservationMapBuilder::AssignChunks(const std::vector<const EBirdDatasetInterface::MapInfo*>& locations)
+{
+	std::vector<std::size_t> chunkStarts;
+	std::size_t checklistCount(0);
+	for (std::size_t i = 0; i < locations.size(); ++i)
 	{
-		Cerr << "Failed to create locations JSON object\n";
-		return false;
+		if (chunkStarts.empty() || (checklistCount > 0 && checklistCount + locations[i]->checklists.size() > maxChecklistsPerChunk))
+		{
+			chunkStarts.push_back(i);
+			checklistCount = 0;
+		}
+		checklistCount += locations[i]->checklists.size();
 	}
 
-	cJSON_AddItemToObject(mapJSON, "features", locations);
+	chunkStarts.push_back(locations.size());
+	return chunkStarts;
+}
+
+// Each zoom level is an array of [latitude, longitude, location count, checklist count, location index]
+// for each grid cell containing at least one location (index is for any one of the locations in the cell).
+// Levels are written until every location is in a cell of its own; beyond that, the page shows the
+// individual locations.
+void ObservationMapBuilder::WriteClusters(const std::vector<const EBirdDatasetInterface::MapInfo*>& locations, JSONWriter& writer)
+{
+	std::vector<Point> positions(locations.size());
+	for (std::size_t i = 0; i < locations.size(); ++i)
+		positions[i] = Project(locations[i]->latitude, locations[i]->longitude);
 
-	for (const auto& m : mapInfo)
+	writer.BeginArray();
+	for (unsigned int zoom = 0; zoom <= maxClusterZoom; ++zoom)
 	{
-		auto jsonMapInfo(cJSON_CreateObject());
-		if (!jsonMapInfo)
+		const double scale(std::pow(2.0, zoom) / clusterCellSize);
+		std::map<std::pair<int64_t, int64_t>, ClusterBucket> buckets;
+		for (std::size_t i = 0; i < locations.size(); ++i)
 		{
-			Cerr << "Failed to create map info JSON object\n";
-			return false;
+			const auto cell(std::make_pair(static_cast<int64_t>(std::floor(positions[i].x * scale)),
+				static_cast<int64_t>(std::floor(positions[i].y * scale))));
+			auto& bucket(buckets[cell]);
+			if (bucket.locationCount == 0)
+				bucket.location = i;
+			bucket.latitudeSum += locations[i]->latitude;
+			bucket.longitudeSum += locations[i]->longitude;
+			++bucket.locationCount;
+			bucket.checklistCount += static_cast<uint32_t>(locations[i]->checklists.size());
 		}
 
-		cJSON_AddItemToArray(locations, jsonMapInfo);
-		if (!BuildLocationJSON(m, jsonMapInfo))
-			return false;
+		if (buckets.size() == locations.size())
+			break;
+
+		writer.BeginArray();
+		for (const auto& b : buckets)
+		{
+			writer.BeginArray();
+			writer.Number(RoundCoordinate(b.second.latitudeSum / b.second.locationCount));
+			writer.Number(RoundCoordinate(b.second.longitudeSum / b.second.locationCount));
+			writer.Integer(b.second.locationCount);
+			writer.Integer(b.second.checklistCount);
+			writer.Integer(static_cast<int64_t>(b.second.location));
+			writer.EndArray();
+		}
+		writer.EndArray();
 	}
+	writer.EndArray();
+}
 
-	return true;
+// Cluster positions don't need more than about one meter of resolution
+double ObservationMapBuilder::RoundCoordinate(const double& value)
+{
+	return std::round(value * 1.0e5) / 1.0e5;
 }
 
-bool ObservationMapBuilder::BuildLocationJSON(const EBirdDatasetInterface::MapInfo& mapInfo, cJSON* json)
+// Each location is [latitude, longitude, name, checklist count, chunk index]
+void ObservationMapBuilder::WriteLocations(const std::vector<const EBirdDatasetInterface::MapInfo*>& locations,
+	const std::vector<std::size_t>& chunkStarts, JSONWriter& writer)
 {
-	cJSON_AddStringToObject(json, "name", UString::ToNarrowString(mapInfo.locationName).c_str());
-	cJSON_AddNumberToObject(json, "latitude", mapInfo.latitude);
-	cJSON_AddNumberToObject(json, "longitude", mapInfo.longitude);
-	
-	auto checklistList(cJSON_CreateArray());
-	if (!checklistList)
+	writer.BeginArray();
+	std::size_t chunk(0);
+	for (std::size_t i = 0; i < locations.size(); ++i)
 	{
-		Cerr << "Failed to create checklist list JSON object\n";
-		return false;
+		while (i >= chunkStarts[chunk + 1])
+			++chunk;
+
+		writer.BeginArray();
+		writer.Number(locations[i]->latitude);
+		writer.Number(locations[i]->longitude);
+		writer.String(UString::ToNarrowString(locations[i]->locationName));
+		writer.Integer(static_cast<int64_t>(locations[i]->checklists.size()));
+		writer.Integer(static_cast<int64_t>(chunk));
+		writer.EndArray();
 	}
+	writer.EndArray();
+}
 
-	cJSON_AddItemToObject(json, "checklists", checklistList);
-	auto checklistCopy(mapInfo.checklists);
-	std::sort(checklistCopy.begin(), checklistCopy.end(),
-		[](const EBirdDatasetInterface::MapInfo::ChecklistInfo& a, const EBirdDatasetInterface::MapInfo::ChecklistInfo& b)
+// Chunk files are loaded by the page (as scripts) the first time a location in the chunk is opened.
+// Each calls loadChecklistChunk(chunk, first location index, checklists), where checklists contains
+// an array of [checklist ID, date, species count] for each location (newest first).
+bool ObservationMapBuilder::WriteChecklistChunks(const UString::String& dataFileName,
+	const std::vector<const EBirdDatasetInterface::MapInfo*>& locations, const std::vector<std::size_t>& chunkStarts)
+{
+	for (std::size_t chunk = 0; chunk + 1 < chunkStarts.size(); ++chunk)
 	{
-		const auto dash1a(a.dateString.find('-'));
-		const auto dash1b(b.dateString.find('-'));
-		const auto dash2a(a.dateString.find_last_of('-'));
-		const auto dash2b(b.dateString.find_last_of('-'));
-		assert(dash1a != std::string::npos && dash2a != std::string::npos && dash1b != std::string::npos && dash2b != std::string::npos);
-		assert(dash1a != dash2a && dash1b != dash2b);
-		
-		UString::IStringStream ss;
-		unsigned int aValue, bValue;
-		
-		// Year
-		ss.str(a.dateString.substr(dash2a + 1));
-		ss >> aValue;
-		ss.clear();
-		ss.str(b.dateString.substr(dash2b + 1));
-		ss >> bValue;
-		if (aValue > bValue)
-			return true;
-		else if (aValue < bValue)
-			return false;
-			
-		// Month
-		ss.clear();
-		ss.str(a.dateString.substr(0, dash1a));
-		ss >> aValue;
-		ss.clear();
-		ss.str(b.dateString.substr(0, dash1b));
-		ss >> bValue;
-		if (aValue > bValue)
-			return true;
-		else if (aValue < bValue)
+		const UString::String fileName(GetChunkFileName(dataFileName, chunk));
+		std::ofstream file(fileName);
+		if (!file.is_open() || !file.good())
+		{
+			Cerr << "Failed to open '" << fileName << "' for output\n";
 			return false;
-			
-		// Day
-		ss.clear();
-		ss.str(a.dateString.substr(dash1a + 1, dash2a - dash1a - 1));
-		ss >> aValue;
-		ss.clear();
-		ss.str(b.dateString.substr(dash1b + 1, dash2b - dash1b - 1));
-		ss >> bValue;
-		return aValue > bValue;
-	});
-	for (const auto& c : checklistCopy)
-	{
-		auto checklistJSON(cJSON_CreateObject());
-		if (!checklistJSON)
+		}
+
+		JSONWriter writer(file);
+		writer.Raw("loadChecklistChunk(" + std::to_string(chunk) + ", " + std::to_string(chunkStarts[chunk]) + ", ");
+		writer.BeginArray();
+		for (auto i = chunkStarts[chunk]; i < chunkStarts[chunk + 1]; ++i)
 		{
-			Cerr << "Failed to create checklist JSON object\n";
+			auto checklistCopy(locations[i]->checklists);
+			std::sort(checklistCopy.begin(), checklistCopy.end(), ChecklistIsNewer);
+
+			writer.BeginArray();
+			for (const auto& c : checklistCopy)
+			{
+				writer.BeginArray();
+				writer.String(UString::ToNarrowString(c.id));
+				writer.String(UString::ToNarrowString(c.dateString));
+				writer.Integer(c.speciesCount);
+				writer.EndArray();
+			}
+			writer.EndArray();
+		}
+		writer.EndArray();
+		writer.Raw(");\n");
+
+		if (!writer.Flush())
+		{
+			Cerr << "Failed to write to '" << fileName << "'\n";
 			return false;
 		}
-		
-		cJSON_AddStringToObject(checklistJSON, "checklistID", UString::ToNarrowString(c.id).c_str());
-		cJSON_AddStringToObject(checklistJSON, "date", UString::ToNarrowString(c.dateString).c_str());
-		cJSON_AddNumberToObject(checklistJSON, "speciesCount", c.speciesCount);
-		cJSON_AddItemToArray(checklistList, checklistJSON);
 	}
 
 	return true;
 }
 
+UString::String ObservationMapBuilder::GetChunkFileName(const UString::String& dataFileName, const std::size_t& chunk)
+{
+	UString::OStringStream ss;
+	ss << dataFileName.substr(0, dataFileName.find_last_of('.')) << "_checklists" << chunk << ".js";
+	return ss.str();
+}
+
+// Dates are formatted as month-day-year
+bool ObservationMapBuilder::ChecklistIsNewer(const EBirdDatasetInterface::MapInfo::ChecklistInfo& a, const EBirdDatasetInterface::MapInfo::ChecklistInfo& b)
+{
+	const auto dash1a(a.dateString.find('-'));
+	const auto dash1b(b.dateString.find('-'));
+	const auto dash2a(a.dateString.find_last_of('-'));
+	const auto dash2b(b.dateString.find_last_of('-'));
+	assert(dash1a != std::string::npos && dash2a != std::string::npos && dash1b != std::string::npos && dash2b != std::string::npos);
+	assert(dash1a != dash2a && dash1b != dash2b);
+	
+	UString::IStringStream ss;
+	unsigned int aValue, bValue;
+	
+	// Year
+	ss.str(a.dateString.substr(dash2a + 1));
+	ss >> aValue;
+	ss.clear();
+	ss.str(b.dateString.substr(dash2b + 1));
+	ss >> bValue;
+	if (aValue > bValue)
+		return true;
+	else if (aValue < bValue)
+		return false;
+		
+	// Month
+	ss.clear();
+	ss.str(a.dateString.substr(0, dash1a));
+	ss >> aValue;
+	ss.clear();
+	ss.str(b.dateString.substr(0, dash1b));
+	ss >> bValue;
+	if (aValue > bValue)
+		return true;
+	else if (aValue < bValue)
+		return false;
+		
+	// Day
+	ss.clear();
+	ss.str(a.dateString.substr(dash1a + 1, dash2a - dash1a - 1));
+	ss >> aValue;
+	ss.clear();
+	ss.str(b.dateString.substr(dash1b + 1, dash2b - dash1b - 1));
+	ss >> bValue;
+	return aValue > bValue;
+}
+
 bool ObservationMapBuilder::WriteHTMLFile(const UString::String& fileName) const
 {
 	/*
@@ -381,39 +552,110 @@ bool ObservationMapBuilder::WriteHTMLFile(const UString::String& fileName) const
       }
       
       var markerLayerGroup = L.layerGroup().addTo(map);
-      function buildPointLayer() {
+      var checklistChunks = [];
+      var checklistChunkRequested = [];
+      var pendingChecklistRequests = [];
+
+      // Called by the checklist chunk files
+      function loadChecklistChunk(chunk, firstLocation, checklists) {
+        checklistChunks[chunk] = { firstLocation: firstLocation, checklists: checklists };
+        var stillPending = [];
+        for (const request of pendingChecklistRequests) {
+          if (request.chunk == chunk) {
+            request.callback(checklists[request.index - firstLocation]);
+          } else {
+            stillPending.push(request);
+          }
+        }
+        pendingChecklistRequests = stillPending;
+      }
+
+      function getChecklists(index, callback) {
+        var chunk = locationData.locations[index][4];
+        if (checklistChunks[chunk]) {
+          callback(checklistChunks[chunk].checklists[index - checklistChunks[chunk].firstLocation]);
+          return;
+        }
+
+        pendingChecklistRequests.push({ chunk: chunk, index: index, callback: callback });
+        if (!checklistChunkRequested[chunk]) {
+          checklistChunkRequested[chunk] = true;
+          var script = document.createElement('script');
+          script.src = locationData.chunkFiles[chunk];
+          document.body.appendChild(script);
+        }
+      }
+
+      // Each checklist is [checklist ID, date, species count]
+      function buildPopupText(name, checklists) {
 		  var startDate = parseDate(document.getElementById('startDate').value);
-		  var startDateYear = startDate[0];
-		  var startDateMonth = startDate[1];
-		  var startDateDay = startDate[2];
-		  
 		  var endDate = parseDate(document.getElementById('endDate').value);
-		  var endDateYear = endDate[0];
-		  var endDateMonth = endDate[1];
-		  var endDateDay = endDate[2];
-
-		  for (const location of mapInfo.features) {
-		    var marker = L.marker([location.latitude, location.longitude]);
-		    var popupText = "<h3>" + location.name + "</h3><p><table><tr><td>Checklist Link</td><td>Species Count</td></tr>";
-		    var checklistCount = 0;
-		    for (const checklist of location.checklists) {
-              if (dateIsInRange(checklist.date, startDateYear, startDateMonth, startDateDay, endDateYear, endDateMonth, endDateDay)) {
-                popupText += '<tr><td><a href="https://ebird.org/checklist/' + checklist.checklistID + '" target="_blank">' + checklist.date + '</a></td><td>' + checklist.speciesCount + '</td></tr>';
-                ++checklistCount;
-              }
-			}
+		  var popupText = "<h3>" + name + "</h3><p><table><tr><td>Checklist Link</td><td>Species Count</td></tr>";
+		  var checklistCount = 0;
+		  for (const checklist of checklists) {
+            if (dateIsInRange(checklist[1], startDate[0], startDate[1], startDate[2], endDate[0], endDate[1], endDate[2])) {
+              popupText += '<tr><td><a href="https://ebird.org/checklist/' + checklist[0] + '" target="_blank">' + checklist[1] + '</a></td><td>' + checklist[2] + '</td></tr>';
+              ++checklistCount;
+            }
+		  }
+
+		  if (checklistCount == 0)
+            return "<h3>" + name + "</h3><p>No checklists within the specified date range</p>";
+
+		  // TODO:  Needs scrolling section (so title doesn't scroll)
+		  return popupText + '</table></p>';
+	  }
 
-            // Don't add the marker if there aren't any checklists (within the specified date range)
-			if (checklistCount == 0)
+      // Each location is [latitude, longitude, name, checklist count, chunk index]
+      function addLocationMarker(index) {
+        var location = locationData.locations[index];
+        var marker = L.marker([location[0], location[1]]);
+        marker.bindPopup("<h3>" + location[2] + "</h3><p>Loading " + location[3] + " checklists...</p>", { maxHeight:300 });
+        marker.on('popupopen', function(e) {
+          getChecklists(index, function(checklists) {
+            e.popup.setContent(buildPopupText(location[2], checklists));
+          });
+        });
+        marker.addTo(markerLayerGroup);
+      }
+
+      // Clusters are [latitude, longitude, location count, checklist count, location index] (see
+      // ObservationMapBuilder::WriteClusters()); beyond the last cluster level, each location is shown
+      function buildPointLayer() {
+        markerLayerGroup.clearLayers();
+        var zoom = Math.round(map.getZoom());
+        var bounds = map.getBounds().pad(0.5);
+        if (zoom < locationData.clusters.length) {
+          for (const cluster of locationData.clusters[zoom]) {
+            if (!bounds.contains([cluster[0], cluster[1]])) {
               continue;
+            }
 
-			popupText += '</table></p>';
-			// TODO:  Needs scrolling section (so title doesn't scroll)
-			marker.addTo(markerLayerGroup);
-		    marker.bindPopup(popupText, { maxHeight:300 });
-	    }
+            if (cluster[2] == 1) {
+              addLocationMarker(cluster[4]);
+              continue;
+            }
+
+            var marker = L.marker([cluster[0], cluster[1]], { icon: L.divIcon({
+              html: '<div style="background: rgba(255,255,255,0.8); border-radius: 15px; text-align: center; line-height: 30px; font: bold 12px sans-serif">' + cluster[2] + '</div>',
+              className: '', iconSize: [30, 30] }) });
+            marker.bindTooltip(cluster[2] + ' locations, ' + cluster[3] + ' checklists');
+            marker.on('click', function(e) {
+              map.setView(e.target.getLatLng(), zoom + 2);
+            });
+            marker.addTo(markerLayerGroup);
+          }
+        } else {
+          locationData.locations.forEach(function(location, index) {
+            if (bounds.contains([location[0], location[1]])) {
+              addLocationMarker(index);
+            }
+          });
+        }
 	  }
 
+      map.on('moveend', buildPointLayer);
+
       function updateMapDisplay() {
         geoJson.setStyle(style);
         markerLayerGroup.clearLayers();
@@ -9,6 +9,13 @@
 // Local headers
 #include "utilities/uString.h"
 #include "eBirdDatasetInterface.h"
+#include "kmlToGeoJSONConverter.h"
+#include "jsonWriter.h"
+#include "point.h"
+
+// Standard C++ headers
+#include <vector>
+#include <cstdint>
 
 class ObservationMapBuilder
 {
@@ -16,13 +23,39 @@ public:
 	bool Build(const UString::String& outputFileName, const UString::String& kmlBoundaryFileName, const std::vector<EBirdDatasetInterface::MapInfo>& mapInfo) const;
 
 private:
-	bool WriteDataFile(const UString::String& fileName, const UString::String& kml, const std::vector<EBirdDatasetInterface::MapInfo>& mapInfo) const;
+	bool WriteDataFile(const UString::String& fileName, const UString::String& kml, const UString::String& kmlFileName, const std::vector<EBirdDatasetInterface::MapInfo>& mapInfo) const;
 	bool WriteHTMLFile(const UString::String& fileName) const;
 	
-	static bool CreateJSONData(const UString::String& kml, const double& kmlReductionLimit, cJSON*& geoJSON);
-	static bool CreateJSONData(const std::vector<EBirdDatasetInterface::MapInfo>& mapInfo, cJSON*& mapJSON);
-	static bool BuildGeometryJSON(const UString::String& kml, const double& kmlReductionLimit, cJSON* json);
-	static bool BuildLocationJSON(const EBirdDatasetInterface::MapInfo& mapInfo, cJSON* json);
+	static bool CreateJSONData(const UString::String& kml, const UString::String& kmlFileName, const double& kmlReductionLimit, cJSON*& geoJSON);
+	static bool BuildGeometryJSON(const UString::String& kml, const UString::String& kmlFileName, const double& kmlReductionLimit, cJSON* json);
+	static std::vector<KMLToGeoJSONConverter::Polygon> GetBoundaryPolygons(const UString::String& kml, const UString::String& kmlFileName, const double& kmlReductionLimit);
+
+	// Locations are written as pre-aggregated clusters for each zoom level, with the checklists for
+	// each location split into chunk files which the page loads only when they are needed
+	static const unsigned int maxClusterZoom;
+	static const double clusterCellSize;// [px]
+	static const std::size_t maxChecklistsPerChunk;
+
+	struct ClusterBucket
+	{
+		double latitudeSum = 0.0;// [deg]
+		double longitudeSum = 0.0;// [deg]
+		uint32_t locationCount = 0;
+		uint32_t checklistCount = 0;
+		std::size_t location = 0;
+	};
+
+	static std::vector<const EBirdDatasetInterface::MapInfo*> SortLocations(const std::vector<EBirdDatasetInterface::MapInfo>& mapInfo);
+	static Point Project(const double& latitude, const double& longitude);
+	static std::vector<std::size_t> AssignChunks(const std::vector<const EBirdDatasetInterface::MapInfo*>& locations);
+	static void WriteClusters(const std::vector<const EBirdDatasetInterface::MapInfo*>& locations, JSONWriter& writer);
+	static double RoundCoordinate(const double& value);
+	static void WriteLocations(const std::vector<const EBirdDatasetInterface::MapInfo*>& locations,
+		const std::vector<std::size_t>& chunkStarts, JSONWriter& writer);
+	static bool WriteChecklistChunks(const UString::String& dataFileName,
+		const std::vector<const EBirdDatasetInterface::MapInfo*>& locations, const std::vector<std::size_t>& chunkStarts);
+	static UString::String GetChunkFileName(const UString::String& dataFileName, const std::size_t& chunk);
+	static bool ChecklistIsNewer(const EBirdDatasetInterface::MapInfo::ChecklistInfo& a, const EBirdDatasetInterface::MapInfo::ChecklistInfo& b);
 };
 
 #endif// OBSERVATION_MAP_BUILDER_H_
@@ -0,0 +1,261 @@
+// File:  preparedGeometry.cpp
+// Date:  10/18/2026
+// Auth:  K. Loux
+// Desc:  Grid-indexed polygon geometry for repeated point-in-polygon tests.
+
+// Local headers
+#include "preparedGeometry.h"
+
+// Standard C++ headers
+#include <algorithm>
+#include <cmath>
+#include <cassert>
+
+const unsigned int PreparedGeometry::maxGridDimension(2048);
+const double PreparedGeometry::cellsPerEdge(4.0);
+
+PreparedGeometry::PreparedGeometry(const KMLLibraryManager::GeometryInfo& geometry)
+{
+	const auto edges(BuildEdgeList(geometry));
+	if (edges.empty())
+		return;
+
+	ComputeGridSize(edges);
+	BuildGrid(edges);
+}
+
+// Closing segment is included for polygons that don't end with the starting point (same as KMLLibraryManager::PointIsWithinPolygons())
+std::vector<PreparedGeometry::Edge> PreparedGeometry::BuildEdgeList(const KMLLibraryManager::GeometryInfo& geometry)
+{
+	std::vector<Edge> edges;
+	for (const auto& polygon : geometry.GetPolygons())
+	{
+		for (unsigned int i = 1; i < polygon.size(); ++i)
+			edges.push_back(Edge(polygon[i - 1], polygon[i]));
+
+		if (!polygon.empty() && polygon.front() != polygon.back())
+			edges.push_back(Edge(polygon.back(), polygon.front()));
+	}
+
+	return edges;
+}
+
+void PreparedGeometry::ComputeGridSize(const std::vector<Edge>& edges)
+{
+	minLongitude = edges.front().start.longitude;
+	maxLongitude = minLongitude;
+	minLatitude = edges.front().start.latitude;
+	maxLatitude = minLatitude;
+	for (const auto& e : edges)
+	{
+		minLongitude = std::min(minLongitude, std::min(e.start.longitude, e.end.longitude));
+		maxLongitude = std::max(maxLongitude, std::max(e.start.longitude, e.end.longitude));
+		minLatitude = std::min(minLatitude, std::min(e.start.latitude, e.end.latitude));
+		maxLatitude = std::max(maxLatitude, std::max(e.start.latitude, e.end.latitude));
+	}
+
+	// Aim for roughly square cells, with a few cells per edge so most cells are free of edges
+	const double minimumSpan(1.0e-9);// [deg]
+	const double width(std::max(maxLongitude - minLongitude, minimumSpan));
+	const double height(std::max(maxLatitude - minLatitude, minimumSpan));
+	const double cellSize(std::sqrt(width * height / (cellsPerEdge * edges.size())));
+	columns = static_cast<unsigned int>(std::min(static_cast<double>(maxGridDimension), std::max(1.0, std::ceil(width / cellSize))));
+	rows = static_cast<unsigned int>(std::min(static_cast<double>(maxGridDimension), std::max(1.0, std::ceil(height / cellSize))));
+	cellWidth = width / columns;
+	cellHeight = height / rows;
+}
+
+void PreparedGeometry::BuildGrid(const std::vector<Edge>& edges)
+{
+	std::vector<std::pair<uint32_t, uint32_t>> cellEdgePairs;// first is cell index, second is edge index
+	std::vector<std::vector<double>> rowCrossings(rows);// Longitudes where edges cross the horizontal line through the cell centers
+
+	// Small padding ensures edges that lie along a cell border are assigned to cells on both sides
+	const double columnPadding(cellWidth * 1.0e-6);
+	const double rowPadding(cellHeight * 1.0e-6);
+	for (uint32_t i = 0; i < edges.size(); ++i)
+	{
+		const auto& e(edges[i]);
+		const double edgeMinLatitude(std::min(e.start.latitude, e.end.latitude));
+		const double edgeMaxLatitude(std::max(e.start.latitude, e.end.latitude));
+		const unsigned int firstRow(GetRow(edgeMinLatitude - rowPadding));
+		const unsigned int lastRow(GetRow(edgeMaxLatitude + rowPadding));
+		for (unsigned int r = firstRow; r <= lastRow; ++r)
+		{
+			const double rowMinLatitude(std::max(edgeMinLatitude, minLatitude + r * cellHeight - rowPadding));
+			const double rowMaxLatitude(std::min(edgeMaxLatitude, minLatitude + (r + 1) * cellHeight + rowPadding));
+
+			double longitude1, longitude2;
+			if (e.start.latitude == e.end.latitude)
+			{
+				longitude1 = e.start.longitude;
+				longitude2 = e.end.longitude;
+			}
+			else
+			{
+				const double slope((e.end.longitude - e.start.longitude) / (e.end.latitude - e.start.latitude));
+				longitude1 = e.start.longitude + (rowMinLatitude - e.start.latitude) * slope;
+				longitude2 = e.start.longitude + (rowMaxLatitude - e.start.latitude) * slope;
+			}
+
+			const unsigned int firstColumn(GetColumn(std::min(longitude1, longitude2) - columnPadding));
+			const unsigned int lastColumn(GetColumn(std::max(longitude1, longitude2) + columnPadding));
+			for (unsigned int c = firstColumn; c <= lastColumn; ++c)
+				cellEdgePairs.push_back(std::make_pair(r * columns + c, i));
+
+			const double centerLatitude(minLatitude + (r + 0.5) * cellHeight);
+			if ((e.start.latitude > centerLatitude) != (e.end.latitude > centerLatitude))
+				rowCrossings[r].push_back(e.start.longitude + (centerLatitude - e.start.latitude)
+					* (e.end.longitude - e.start.longitude) / (e.end.latitude - e.start.latitude));
+		}
+	}
+
+	const auto cellCount(static_cast<std::size_t>(rows) * columns);
+	cellEdgeStart.assign(cellCount + 1, 0);
+	for (const auto& pair : cellEdgePairs)
+		++cellEdgeStart[pair.first + 1];
+	for (std::size_t i = 1; i < cellEdgeStart.size(); ++i)
+		cellEdgeStart[i] += cellEdgeStart[i - 1];
+
+	edgeStartLongitudes.resize(cellEdgePairs.size());
+	edgeStartLatitudes.resize(cellEdgePairs.size());
+	edgeEndLongitudes.resize(cellEdgePairs.size());
+	edgeEndLatitudes.resize(cellEdgePairs.size());
+	std::vector<uint32_t> fillPosition(cellEdgeStart.begin(), cellEdgeStart.end() - 1);
+	for (const auto& pair : cellEdgePairs)
+	{
+		const auto i(fillPosition[pair.first]++);
+		const auto& e(edges[pair.second]);
+		edgeStartLongitudes[i] = e.start.longitude;
+		edgeStartLatitudes[i] = e.start.latitude;
+		edgeEndLongitudes[i] = e.end.longitude;
+		edgeEndLatitudes[i] = e.end.latitude;
+	}
+
+	// Standard crossing-number test for the center of each cell, done one row at a time
+	cellTypes.resize(cellCount);
+	for (unsigned int r = 0; r < rows; ++r)
+	{
+		auto& crossings(rowCrossings[r]);
+		std::sort(crossings.begin(), crossings.end());
+		auto nextCrossing(crossings.begin());
+		for (unsigned int c = 0; c < columns; ++c)
+		{
+			const double centerLongitude(minLongitude + (c + 0.5) * cellWidth);
+			while (nextCrossing != crossings.end() && *nextCrossing <= centerLongitude)
+				++nextCrossing;
+
+			const bool centerIsInside((crossings.end() - nextCrossing) % 2 == 1);
+			const auto cell(r * columns + c);
+			if (cellEdgeStart[cell] == cellEdgeStart[cell + 1])
+				cellTypes[cell] = centerIsInside ? CellType::Inside : CellType::Outside;
+			else
+				cellTypes[cell] = centerIsInside ? CellType::BoundaryCenterInside : CellType::BoundaryCenterOutside;
+		}
+	}
+}
+
+bool PreparedGeometry::IsWithinBounds(const Point& p) const
+{
+	return !cellTypes.empty() &&
+		p.longitude >= minLongitude && p.longitude <= maxLongitude &&
+		p.latitude >= minLatitude && p.latitude <= maxLatitude;
+}
+
+bool PreparedGeometry::ContainsPoint(const Point& p) const
+{
+	if (!IsWithinBounds(p))
+		return false;
+
+	const unsigned int row(GetRow(p.latitude));
+	const unsigned int column(GetColumn(p.longitude));
+	const auto cell(row * columns + column);
+	if (cellTypes[cell] == CellType::Inside)
+		return true;
+	else if (cellTypes[cell] == CellType::Outside)
+		return false;
+
+	return ResolveBoundaryCell(p, row, column);
+}
+
+// Points in cells with no edges are resolved in a first pass, leaving only the
+// (relatively few) points in boundary cells for the crossing tests
+void PreparedGeometry::ContainsPoints(const std::vector<double>& longitudes, const std::vector<double>& latitudes, std::vector<uint8_t>& inside) const
+{
+	assert(longitudes.size() == latitudes.size());
+	inside.assign(longitudes.size(), 0);
+	if (cellTypes.empty())
+		return;
+
+	std::vector<std::size_t> boundaryPoints;
+	for (std::size_t i = 0; i < longitudes.size(); ++i)
+	{
+		if (longitudes[i] < minLongitude || longitudes[i] > maxLongitude ||
+			latitudes[i] < minLatitude || latitudes[i] > maxLatitude)
+			continue;
+
+		const auto cellType(cellTypes[GetRow(latitudes[i]) * columns + GetColumn(longitudes[i])]);
+		if (cellType == CellType::Inside)
+			inside[i] = 1;
+		else if (cellType != CellType::Outside)
+			boundaryPoints.push_back(i);
+	}
+
+	for (const auto& i : boundaryPoints)
+	{
+		const Point p(longitudes[i], latitudes[i]);
+		inside[i] = ResolveBoundaryCell(p, GetRow(p.latitude), GetColumn(p.longitude)) ? 1 : 0;
+	}
+}
+
+// For boundary cells, we count the edges crossed by the segment from the center of the cell
+// to the test point.  Since both points lie within the cell, only the edges passing through
+// the cell need to be considered.
+bool PreparedGeometry::ResolveBoundaryCell(const Point& p, const unsigned int& row, const unsigned int& column) const
+{
+	const auto cell(row * columns + column);
+	const bool centerIsInside(cellTypes[cell] == CellType::BoundaryCenterInside);
+	const auto crossings(CountCrossings(GetCellCenter(row, column), p, cellEdgeStart[cell], cellEdgeStart[cell + 1]));
+	return centerIsInside != (crossings % 2 == 1);
+}
+
+// Written without branches so the compiler can vectorize the loop.  Points exactly on the line
+// are treated as being on the positive side, so a segment passing through a shared vertex is
+// counted as crossing exactly one of the two edges.
+unsigned int PreparedGeometry::CountCrossings(const Point& p1, const Point& p2, const std::size_t& begin, const std::size_t& end) const
+{
+	const double dx(p2.longitude - p1.longitude);
+	const double dy(p2.latitude - p1.latitude);
+	unsigned int crossings(0);
+	for (std::size_t i = begin; i < end; ++i)
+	{
+		const double qdx(edgeEndLongitudes[i] - edgeStartLongitudes[i]);
+		const double qdy(edgeEndLatitudes[i] - edgeStartLatitudes[i]);
+		const double o1(dx * (edgeStartLatitudes[i] - p1.latitude) - dy * (edgeStartLongitudes[i] - p1.longitude));
+		const double o2(dx * (edgeEndLatitudes[i] - p1.latitude) - dy * (edgeEndLongitudes[i] - p1.longitude));
+		const double o3(qdx * (p1.latitude - edgeStartLatitudes[i]) - qdy * (p1.longitude - edgeStartLongitudes[i]));
+		const double o4(qdx * (p2.latitude - edgeStartLatitudes[i]) - qdy * (p2.longitude - edgeStartLongitudes[i]));
+		crossings += static_cast<unsigned int>(((o1 > 0.0) != (o2 > 0.0)) & ((o3 > 0.0) != (o4 > 0.0)));
+	}
+
+	return crossings;
+}
+
+unsigned int PreparedGeometry::GetColumn(const double& longitude) const
+{
+	if (longitude <= minLongitude)
+		return 0;
+	return std::min(columns - 1, static_cast<unsigned int>((longitude - minLongitude) / cellWidth));
+}
+
+unsigned int PreparedGeometry::GetRow(const double& latitude) const
+{
+	if (latitude <= minLatitude)
+		return 0;
+	return std::min(rows - 1, static_cast<unsigned int>((latitude - minLatitude) / cellHeight));
+}
+
+PreparedGeometry::Point PreparedGeometry::GetCellCenter(const unsigned int& row, const unsigned int& column) const
+{
+	return Point(minLongitude + (column + 0.5) * cellWidth, minLatitude + (row + 0.5) * cellHeight);
+}
@@ -0,0 +1,83 @@
+// File:  preparedGeometry.h
+// Date:  10/18/2026
+// Auth:  K. Loux
+// Desc:  Grid-indexed polygon geometry for repeated point-in-polygon tests.
+
+#ifndef PREPARED_GEOMETRY_H_
+#define PREPARED_GEOMETRY_H_
+
+// Local headers
+#include "kmlLibraryManager.h"
+
+// Standard C++ headers
+#include <vector>
+#include <cstdint>
+
+class PreparedGeometry
+{
+public:
+	explicit PreparedGeometry(const KMLLibraryManager::GeometryInfo& geometry);
+
+	bool ContainsPoint(const KMLLibraryManager::GeometryInfo::Point& p) const;
+	bool IsWithinBounds(const KMLLibraryManager::GeometryInfo::Point& p) const;
+
+	// Classifies a block of points at once; inside[i] is set to 1 if point i is within the geometry, or 0 otherwise
+	void ContainsPoints(const std::vector<double>& longitudes, const std::vector<double>& latitudes, std::vector<uint8_t>& inside) const;
+
+private:
+	typedef KMLLibraryManager::GeometryInfo::Point Point;
+
+	static const unsigned int maxGridDimension;
+	static const double cellsPerEdge;
+
+	struct Edge
+	{
+		Edge(const Point& start, const Point& end) : start(start), end(end) {}
+
+		Point start;
+		Point end;
+	};
+
+	// Cells with no edges passing through them are entirely inside or entirely outside the geometry.
+	// For boundary cells, we store whether or not the center of the cell is inside the geometry.
+	enum class CellType : uint8_t
+	{
+		Outside,
+		Inside,
+		BoundaryCenterOutside,
+		BoundaryCenterInside
+	};
+
+	double minLongitude = 0.0;// [deg]
+	double minLatitude = 0.0;// [deg]
+	double maxLongitude = 0.0;// [deg]
+	double maxLatitude = 0.0;// [deg]
+	double cellWidth = 0.0;// [deg]
+	double cellHeight = 0.0;// [deg]
+	unsigned int columns = 0;
+	unsigned int rows = 0;
+
+	std::vector<CellType> cellTypes;
+	std::vector<uint32_t> cellEdgeStart;// Index into edge coordinate vectors; size is cell count + 1
+
+	// Edge coordinates are stored in cell order (edges passing through more than one cell are repeated)
+	// so the edges for each boundary cell are contiguous
+	std::vector<double> edgeStartLongitudes;// [deg]
+	std::vector<double> edgeStartLatitudes;// [deg]
+	std::vector<double> edgeEndLongitudes;// [deg]
+	std::vector<double> edgeEndLatitudes;// [deg]
+
+	static std::vector<Edge> BuildEdgeList(const KMLLibraryManager::GeometryInfo& geometry);
+	void ComputeGridSize(const std::vector<Edge>& edges);
+	void BuildGrid(const std::vector<Edge>& edges);
+
+	bool ResolveBoundaryCell(const Point& p, const unsigned int& row, const unsigned int& column) const;
+
+	unsigned int GetColumn(const double& longitude) const;
+	unsigned int GetRow(const double& latitude) const;
+	Point GetCellCenter(const unsigned int& row, const unsigned int& column) const;
+
+	unsigned int CountCrossings(const Point& p1, const Point& p2, const std::size_t& begin, const std::size_t& end) const;
+};
+
+#endif// PREPARED_GEOMETRY_H_
@@ -0,0 +1,407 @@
+// File:  topologyBuilder.cpp
+// Date:  10/18/2026
+// Auth:  K. Loux
+// Desc:  Builds TopoJSON-style topology from region boundaries, so borders shared by neighboring regions are stored and reduced only once.
+
+// Local headers
+#include "topologyBuilder.h"
+#include "geometryReducer.h"
+#include "geometryCache.h"
+#include "binaryIO.h"
+
+// Standard C++ headers
+#include <algorithm>
+#include <functional>
+#include <thread>
+#include <cassert>
+
+const std::size_t TopologyBuilder::minParallelArcCount(256);
+
+TopologyBuilder::TopologyBuilder(const std::vector<double>& reductionLimits) : reductionLimits(reductionLimits)
+{
+	assert(!reductionLimits.empty());
+	assert(std::is_sorted(reductionLimits.begin(), reductionLimits.end()));
+}
+
+// Rings with fewer than three distinct points are discarded, as are polygons without a valid outer boundary
+void TopologyBuilder::AddRegion(const BoundaryCache::Region& region)
+{
+	regions.push_back(std::vector<Polygon>());
+	for (std::size_t p = 0; p + 1 < region.polygonStarts.size(); ++p)
+	{
+		Polygon cleanPolygon;
+		for (auto r = region.polygonStarts[p]; r < region.polygonStarts[p + 1]; ++r)
+		{
+			LinearRing ring;
+			ring.reserve(region.ringStarts[r + 1] - region.ringStarts[r]);
+			for (auto i = region.ringStarts[r]; i < region.ringStarts[r + 1]; ++i)
+				ring.push_back(Point{ region.longitudes[i], region.latitudes[i] });
+
+			auto cleanRing(RemoveRepeatedPoints(ring));
+			if (cleanRing.size() >= 3)
+				cleanPolygon.push_back(std::move(cleanRing));
+			else if (cleanPolygon.empty())
+				break;
+		}
+
+		if (!cleanPolygon.empty())
+			regions.back().push_back(std::move(cleanPolygon));
+	}
+}
+
+// Returned ring is not closed (closing point is implied)
+TopologyBuilder::LinearRing TopologyBuilder::RemoveRepeatedPoints(const LinearRing& ring)
+{
+	LinearRing cleanRing;
+	for (const auto& p : ring)
+	{
+		if (cleanRing.empty() || !PointsAreEqual(p, cleanRing.back()))
+			cleanRing.push_back(p);
+	}
+
+	while (cleanRing.size() > 1 && PointsAreEqual(cleanRing.front(), cleanRing.back()))
+		cleanRing.pop_back();
+
+	return cleanRing;
+}
+
+void TopologyBuilder::Build()
+{
+	for (const auto& region : regions)
+	{
+		for (const auto& polygon : region)
+		{
+			for (const auto& ring : polygon)
+				AddNeighbors(ring);
+		}
+	}
+
+	regionArcs.resize(regions.size());
+	for (std::size_t i = 0; i < regions.size(); ++i)
+	{
+		for (const auto& polygon : regions[i])
+		{
+			regionArcs[i].push_back(PolygonArcs());
+			for (const auto& ring : polygon)
+				regionArcs[i].back().push_back(CutRing(ring));
+		}
+	}
+
+	std::vector<std::vector<Polygon>>().swap(regions);
+	JunctionMap().swap(points);
+	arcHashes.clear();
+
+	ReduceArcs();
+}
+
+// A point is a junction if it doesn't have the same neighbors everywhere it appears
+void TopologyBuilder::AddNeighbors(const LinearRing& ring)
+{
+	const auto n(ring.size());
+	for (std::size_t i = 0; i < n; ++i)
+	{
+		const auto& previous(ring[(i + n - 1) % n]);
+		const auto& next(ring[(i + 1) % n]);
+
+		Neighbors neighbors;
+		neighbors.first = PointIsLess(previous, next) ? previous : next;
+		neighbors.second = PointIsLess(previous, next) ? next : previous;
+
+		const auto result(points.insert(std::make_pair(ring[i], neighbors)));
+		if (!result.second && (!PointsAreEqual(result.first->second.first, neighbors.first) ||
+			!PointsAreEqual(result.first->second.second, neighbors.second)))
+			result.first->second.isJunction = true;
+	}
+}
+
+TopologyBuilder::ArcList TopologyBuilder::CutRing(const LinearRing& ring)
+{
+	const auto n(ring.size());
+	std::vector<std::size_t> junctions;
+	for (std::size_t i = 0; i < n; ++i)
+	{
+		if (points.find(ring[i])->second.isJunction)
+			junctions.push_back(i);
+	}
+
+	ArcList arcList;
+	if (junctions.empty())
+	{
+		// Closed arc starting from the smallest point, so the same ring is always split at the same place
+		const auto start(std::min_element(ring.begin(), ring.end(), PointIsLess));
+		LinearRing arc(start, ring.end());
+		arc.insert(arc.end(), ring.begin(), start + 1);
+		arcList.push_back(AddArc(std::move(arc)));
+		return arcList;
+	}
+
+	for (std::size_t j = 0; j < junctions.size(); ++j)
+	{
+		const auto start(junctions[j]);
+		const auto end(j + 1 < junctions.size() ? junctions[j + 1] : junctions.front() + n);
+		LinearRing arc;
+		for (auto i = start; i <= end; ++i)
+			arc.push_back(ring[i % n]);
+		arcList.push_back(AddArc(std::move(arc)));
+	}
+
+	return arcList;
+}
+
+// Arcs are stored in a consistent direction so shared arcs are found regardless of ring orientation
+int TopologyBuilder::AddArc(LinearRing arc)
+{
+	const bool reverse(PointIsLess(arc.back(), arc.front()) ||
+		(PointsAreEqual(arc.front(), arc.back()) && arc.size() > 2 && PointIsLess(arc[arc.size() - 2], arc[1])));
+	if (reverse)
+		std::reverse(arc.begin(), arc.end());
+
+	auto& candidates(arcHashes[HashArc(arc)]);
+	for (const auto& i : candidates)
+	{
+		if (arcs[i].size() == arc.size() && std::equal(arc.begin(), arc.end(), arcs[i].begin(), PointsAreEqual))
+			return reverse ? ~i : i;
+	}
+
+	const int index(static_cast<int>(arcs.size()));
+	candidates.push_back(index);
+	arcs.push_back(std::move(arc));
+	return reverse ? ~index : index;
+}
+
+// All levels are generated from a single reduction pass (at the smallest non-zero limit).
+// End points of arcs are always retained, so reduced arcs still meet at the junctions.
+void TopologyBuilder::ReduceArcs()
+{
+	const auto smallestLimit(std::upper_bound(reductionLimits.begin(), reductionLimits.end(), 0.0));
+	const GeometryReducer reducer(smallestLimit == reductionLimits.end() ? 0.0 : *smallestLimit);
+	const GeometryReducer* reducerPointer(smallestLimit == reductionLimits.end() ? nullptr : &reducer);
+
+	levelArcs.assign(reductionLimits.size(), std::vector<LinearRing>(arcs.size()));
+	if (arcs.size() < minParallelArcCount)
+	{
+		for (std::size_t i = 0; i < arcs.size(); ++i)
+			ReduceArc(i, reducerPointer);
+	}
+	else
+	{
+		// Most arcs are short, so arcs are grouped into blocks to keep the job overhead small
+		const unsigned int threadCount(std::max(1U, std::thread::hardware_concurrency()));
+		const std::size_t blockSize((arcs.size() + threadCount * 8 - 1) / (threadCount * 8));
+		ThreadPool pool(threadCount, 0);
+		for (std::size_t i = 0; i < arcs.size(); i += blockSize)
+			pool.AddJob(std::make_unique<ReduceJobInfo>(i, std::min(i + blockSize, arcs.size()), reducerPointer, *this));
+		pool.WaitForAllJobsComplete();
+	}
+
+	std::vector<LinearRing>().swap(arcs);
+}
+
+void TopologyBuilder::ReduceArc(const std::size_t& i, const GeometryReducer* reducer)
+{
+	std::vector<double> significance;
+	if (reducer)
+		reducer->ComputeSignificance(arcs[i], significance);
+
+	for (unsigned int j = 0; j < reductionLimits.size(); ++j)
+	{
+		if (reductionLimits[j] > 0.0)
+			levelArcs[j][i] = GeometryReducer::Reduce(arcs[i], significance, reductionLimits[j]);
+		else
+			levelArcs[j][i] = arcs[i];
+	}
+}
+
+void TopologyBuilder::WriteArcs(const unsigned int& level, JSONWriter& writer) const
+{
+	assert(level < levelArcs.size());
+	writer.BeginArray();
+	for (const auto& arc : levelArcs[level])
+	{
+		writer.BeginArray();
+		for (const auto& point : arc)
+		{
+			writer.BeginArray();
+			writer.Number(point.x);
+			writer.Number(point.y);
+			writer.EndArray();
+		}
+		writer.EndArray();
+	}
+	writer.EndArray();
+}
+
+// Caller is responsible for beginning and ending the geometry object, so other members (i.e. properties) can be added
+void TopologyBuilder::WriteGeometry(const std::size_t& region, JSONWriter& writer) const
+{
+	assert(region < regionArcs.size());
+	writer.Key("type");
+	writer.String("MultiPolygon");
+	writer.Key("arcs");
+	writer.BeginArray();
+	for (const auto& polygon : regionArcs[region])
+	{
+		writer.BeginArray();
+		for (const auto& ring : polygon)
+		{
+			writer.BeginArray();
+			for (const auto& arc : ring)
+				writer.Integer(arc);
+			writer.EndArray();
+		}
+		writer.EndArray();
+	}
+	writer.EndArray();
+}
+
+std::vector<TopologyBuilder::Polygon> TopologyBuilder::GetRegionPolygons(const std::size_t& region, const unsigned int& level) const
+{
+	assert(region < regionArcs.size());
+	assert(level < levelArcs.size());
+	std::vector<Polygon> polygons;
+	for (const auto& polygonArcs : regionArcs[region])
+	{
+		polygons.push_back(Polygon());
+		for (const auto& ringArcs : polygonArcs)
+		{
+			LinearRing ring;
+			for (const auto& arcIndex : ringArcs)
+			{
+				const auto& arc(levelArcs[level][arcIndex < 0 ? ~arcIndex : arcIndex]);
+
+				// Adjacent arcs share end points, so the first point of each arc after the first is skipped
+				const std::size_t skip(ring.empty() ? 0 : 1);
+				if (arcIndex < 0)
+					ring.insert(ring.end(), arc.rbegin() + skip, arc.rend());
+				else
+					ring.insert(ring.end(), arc.begin() + skip, arc.end());
+			}
+
+			polygons.back().push_back(std::move(ring));
+		}
+	}
+
+	return polygons;
+}
+
+bool TopologyBuilder::Save(std::ofstream& file) const
+{
+	if (!BinaryIO::Write(file, static_cast<uint32_t>(regionArcs.size())))
+		return false;
+
+	for (const auto& region : regionArcs)
+	{
+		if (!BinaryIO::Write(file, static_cast<uint32_t>(region.size())))
+			return false;
+
+		for (const auto& polygon : region)
+		{
+			if (!BinaryIO::Write(file, static_cast<uint32_t>(polygon.size())))
+				return false;
+
+			for (const auto& ring : polygon)
+			{
+				if (!BinaryIO::WriteVector(file, ring))
+					return false;
+			}
+		}
+	}
+
+	for (const auto& arcs : levelArcs)
+	{
+		if (!GeometryCache::WriteRings(file, arcs))
+			return false;
+	}
+
+	return true;
+}
+
+// Topology is unchanged unless all data is read successfully
+bool TopologyBuilder::Load(std::ifstream& file)
+{
+	uint32_t regionCount;
+	if (!BinaryIO::ReadCount(file, sizeof(uint32_t), regionCount))// Each element (here and below) begins with its own count
+		return false;
+
+	std::vector<std::vector<PolygonArcs>> cachedRegionArcs(regionCount);
+	for (auto& region : cachedRegionArcs)
+	{
+		uint32_t polygonCount;
+		if (!BinaryIO::ReadCount(file, sizeof(uint32_t), polygonCount))
+			return false;
+
+		region.resize(polygonCount);
+		for (auto& polygon : region)
+		{
+			uint32_t ringCount;
+			if (!BinaryIO::ReadCount(file, sizeof(uint32_t), ringCount))
+				return false;
+
+			polygon.resize(ringCount);
+			for (auto& ring : polygon)
+			{
+				if (!BinaryIO::ReadVector(file, ring))
+					return false;
+			}
+		}
+	}
+
+	std::vector<std::vector<LinearRing>> cachedLevelArcs(reductionLimits.size());
+	for (auto& arcs : cachedLevelArcs)
+	{
+		if (!GeometryCache::ReadRings(file, arcs) || arcs.size() != cachedLevelArcs.front().size())
+			return false;
+	}
+
+	for (const auto& region : cachedRegionArcs)
+	{
+		for (const auto& polygon : region)
+		{
+			for (const auto& ring : polygon)
+			{
+				for (const auto& arc : ring)
+				{
+					if (static_cast<std::size_t>(arc < 0 ? ~arc : arc) >= cachedLevelArcs.front().size())
+						return false;
+				}
+			}
+		}
+	}
+
+	regionArcs = std::move(cachedRegionArcs);
+	levelArcs = std::move(cachedLevelArcs);
+	return true;
+}
+
+bool TopologyBuilder::PointIsLess(const Point& a, const Point& b)
+{
+	if (a.x == b.x)
+		return a.y < b.y;
+	return a.x < b.x;
+}
+
+bool TopologyBuilder::PointsAreEqual(const Point& a, const Point& b)
+{
+	return a.x == b.x && a.y == b.y;
+}
+
+std::size_t TopologyBuilder::HashArc(const LinearRing& arc)
+{
+	const PointHash hash;
+	std::size_t h(arc.size());
+	for (const auto& p : arc)
+		h ^= hash(p) + 0x9e3779b9 + (h << 6) + (h >> 2);
+	return h;
+}
+
+std::size_t TopologyBuilder::PointHash::operator()(const Point& p) const
+{
+	const std::hash<double> hash;
+	const std::size_t h(hash(p.x));
+	return h ^ (hash(p.y) + 0x9e3779b9 + (h << 6) + (h >> 2));
+}
+
+bool TopologyBuilder::PointEqual::operator()(const Point& a, const Point& b) const
+{
+	return PointsAreEqual(a, b);
+}
@@ -0,0 +1,113 @@
+// File:  topologyBuilder.h
+// Date:  10/18/2026
+// Auth:  K. Loux
+// Desc:  Builds TopoJSON-style topology from region boundaries, so borders shared by neighboring regions are stored and reduced only once.
+
+#ifndef TOPOLOGY_BUILDER_H_
+#define TOPOLOGY_BUILDER_H_
+
+// Local headers
+#include "boundaryCache.h"
+#include "jsonWriter.h"
+#include "kmlToGeoJSONConverter.h"
+#include "point.h"
+#include "threadPool.h"
+
+// Standard C++ headers
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <fstream>
+
+// Local forward declarations
+class GeometryReducer;
+
+// Rings are split into arcs at junctions (points where rings that share a border diverge).  Identical
+// arcs (in either direction) are stored once, so a reduced border is the same for both regions that share it.
+class TopologyBuilder
+{
+public:
+	explicit TopologyBuilder(const std::vector<double>& reductionLimits);// Arcs are reduced at each level
+
+	void AddRegion(const BoundaryCache::Region& region);// Regions are identified by the order in which they are added
+	void Build();
+
+	void WriteArcs(const unsigned int& level, JSONWriter& writer) const;
+	void WriteGeometry(const std::size_t& region, JSONWriter& writer) const;// Members of a MultiPolygon geometry object referencing arcs by index
+
+	typedef KMLToGeoJSONConverter::LinearRing LinearRing;
+	typedef KMLToGeoJSONConverter::Polygon Polygon;
+
+	std::size_t GetRegionCount() const { return regionArcs.size(); }
+	std::vector<Polygon> GetRegionPolygons(const std::size_t& region, const unsigned int& level) const;// Rings are assembled from the arcs (and closed)
+
+	// Built topology can be saved and restored in place of calling AddRegion() and Build()
+	bool Save(std::ofstream& file) const;
+	bool Load(std::ifstream& file);
+
+private:
+	const std::vector<double> reductionLimits;
+
+	std::vector<std::vector<Polygon>> regions;// Released after topology is built
+
+	typedef std::vector<int> ArcList;// Negative values are ones-complement of the index, indicating the arc is reversed
+	typedef std::vector<ArcList> PolygonArcs;
+	std::vector<std::vector<PolygonArcs>> regionArcs;
+
+	std::vector<LinearRing> arcs;
+	std::vector<std::vector<LinearRing>> levelArcs;// Index is reduction level
+
+	struct PointHash
+	{
+		std::size_t operator()(const Point& p) const;
+	};
+
+	struct PointEqual
+	{
+		bool operator()(const Point& a, const Point& b) const;
+	};
+
+	struct Neighbors
+	{
+		Point first;
+		Point second;
+		bool isJunction = false;
+	};
+
+	typedef std::unordered_map<Point, Neighbors, PointHash, PointEqual> JunctionMap;
+	JunctionMap points;
+	std::unordered_map<std::size_t, std::vector<int>> arcHashes;// values are indices into arcs
+
+	static LinearRing RemoveRepeatedPoints(const LinearRing& ring);
+	void AddNeighbors(const LinearRing& ring);
+	ArcList CutRing(const LinearRing& ring);
+	int AddArc(LinearRing arc);
+	void ReduceArcs();
+	void ReduceArc(const std::size_t& i, const GeometryReducer* reducer);
+
+	static const std::size_t minParallelArcCount;
+
+	// Each job writes only to its own (pre-allocated) range of arcs
+	struct ReduceJobInfo : public ThreadPool::JobInfoBase
+	{
+		ReduceJobInfo(const std::size_t& begin, const std::size_t& end, const GeometryReducer* reducer,
+			TopologyBuilder& builder) : begin(begin), end(end), reducer(reducer), builder(builder) {}
+
+		const std::size_t begin;
+		const std::size_t end;
+		const GeometryReducer* reducer;
+		TopologyBuilder& builder;
+
+		void DoJob() override
+		{
+			for (auto i = begin; i < end; ++i)
+				builder.ReduceArc(i, reducer);
+		}
+	};
+
+	static bool PointIsLess(const Point& a, const Point& b);
+	static bool PointsAreEqual(const Point& a, const Point& b);
+	static std::size_t HashArc(const LinearRing& arc);
+};
+
+#endif// TOPOLOGY_BUILDER_H_
@@ -0,0 +1,325 @@
+// File:  vectorTileBuilder.cpp
+// Date:  10/18/2026
+// Auth:  K. Loux
+// Desc:  Writes region geometry as a static pyramid of vector tiles.
+
+// Local headers
+#include "vectorTileBuilder.h"
+#include "jsonWriter.h"
+
+// Standard C++ headers
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <cmath>
+#include <cassert>
+
+const int VectorTileBuilder::extent(4096);
+const int VectorTileBuilder::buffer(64);
+
+VectorTileBuilder::VectorTileBuilder(const TopologyBuilder& topology, const std::vector<double>& reductionLimits)
+	: topology(topology), reductionLimits(reductionLimits)
+{
+	assert(!reductionLimits.empty());
+}
+
+// Tiles are built and written one column at a time, so only a single column of tiles is held in memory.
+// Polygons are visited in order of their first column, keeping a list of those which span the current column.
+bool VectorTileBuilder::WriteTiles(const std::string& path, const unsigned int& maxZoom) const
+{
+	for (unsigned int zoom = 0; zoom <= maxZoom; ++zoom)
+	{
+		const auto polygons(GetProjectedPolygons(zoom));
+		std::vector<std::size_t> order(polygons.size());
+		for (std::size_t i = 0; i < order.size(); ++i)
+			order[i] = i;
+		std::stable_sort(order.begin(), order.end(), [&polygons](const std::size_t& a, const std::size_t& b)
+		{
+			return polygons[a].firstColumn < polygons[b].firstColumn;
+		});
+
+		std::vector<std::size_t> active;// Indices into polygons, kept in ascending order so features in each tile are ordered by region
+		auto next(order.cbegin());
+		for (uint32_t x = 0; x < (1U << zoom); ++x)
+		{
+			if (active.empty())
+			{
+				if (next == order.cend())
+					break;
+				x = std::max(x, polygons[*next].firstColumn);
+			}
+
+			active.erase(std::remove_if(active.begin(), active.end(), [&polygons, x](const std::size_t& i)
+			{
+				return polygons[i].lastColumn < x;
+			}), active.end());
+
+			for (; next != order.cend() && polygons[*next].firstColumn <= x; ++next)
+				active.insert(std::lower_bound(active.begin(), active.end(), *next), *next);
+
+			ColumnTiles tiles;
+			for (const auto& i : active)
+				AddPolygon(polygons[i], zoom, x, tiles);
+
+			for (const auto& tile : tiles)
+			{
+				if (!WriteTile(path, zoom, TileKey(x, tile.first), tile.second))
+					return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+// Use the coarsest geometry for which the reduction limit is no larger than one pixel (same as the topology page)
+unsigned int VectorTileBuilder::ChooseLevel(const unsigned int& zoom) const
+{
+	const double kmPerPixel(40075.016686 / std::pow(2.0, zoom + 8.0));// At the equator
+	unsigned int level(0);
+	while (level + 1 < reductionLimits.size() && reductionLimits[level + 1] <= kmPerPixel)
+		++level;
+	return level;
+}
+
+std::vector<VectorTileBuilder::RegionPolygon> VectorTileBuilder::GetProjectedPolygons(const unsigned int& zoom) const
+{
+	const auto level(ChooseLevel(zoom));
+	std::vector<RegionPolygon> polygons;
+	for (std::size_t i = 0; i < topology.GetRegionCount(); ++i)
+	{
+		for (auto& polygon : GetProjectedPolygons(i, level))
+		{
+			RegionPolygon regionPolygon;
+			regionPolygon.region = i;
+			GetTileRange(polygon.front(), zoom, true, regionPolygon.firstColumn, regionPolygon.lastColumn);
+			regionPolygon.polygon = std::move(polygon);
+			polygons.push_back(std::move(regionPolygon));
+		}
+	}
+
+	return polygons;
+}
+
+// Polygons with degenerate outer boundaries are skipped
+std::vector<VectorTileBuilder::Polygon> VectorTileBuilder::GetProjectedPolygons(const std::size_t& region, const unsigned int& level) const
+{
+	std::vector<Polygon> polygons;
+	for (const auto& polygon : topology.GetRegionPolygons(region, level))
+	{
+		Polygon projectedPolygon;
+		for (const auto& ring : polygon)
+		{
+			Ring projectedRing;
+			projectedRing.reserve(ring.size());
+			for (const auto& p : ring)
+				projectedRing.push_back(Project(p));
+
+			if (projectedRing.size() > 1 && projectedRing.front().x == projectedRing.back().x && projectedRing.front().y == projectedRing.back().y)
+				projectedRing.pop_back();
+
+			if (projectedRing.size() >= 3)
+				projectedPolygon.push_back(std::move(projectedRing));
+			else if (projectedPolygon.empty())
+				break;
+		}
+
+		if (!projectedPolygon.empty())
+			polygons.push_back(std::move(projectedPolygon));
+	}
+
+	return polygons;
+}
+
+// Range of tiles (including the buffer) spanned by the ring in x (if useX is true) or y
+void VectorTileBuilder::GetTileRange(const Ring& ring, const unsigned int& zoom, const bool& useX, uint32_t& first, uint32_t& last)
+{
+	const double scale(std::pow(2.0, zoom) * extent);// [tile units per normalized unit]
+	const uint32_t maxTile((1U << zoom) - 1);
+	const double padding(static_cast<double>(buffer) / scale);
+	const double tileSize(static_cast<double>(extent) / scale);
+
+	const auto compare([useX](const Point& a, const Point& b)
+	{
+		return useX ? a.x < b.x : a.y < b.y;
+	});
+	const auto range(std::minmax_element(ring.begin(), ring.end(), compare));
+
+	const auto getTile([maxTile, tileSize](const double& value)
+	{
+		return static_cast<uint32_t>(std::min(static_cast<double>(maxTile), std::max(0.0, std::floor(value / tileSize))));
+	});
+
+	first = getTile((useX ? range.first->x : range.first->y) - padding);
+	last = getTile((useX ? range.second->x : range.second->y) + padding);
+}
+
+// The polygon is clipped to column x, then the column is clipped to each row it spans
+void VectorTileBuilder::AddPolygon(const RegionPolygon& polygon, const unsigned int& zoom, const uint32_t& x, ColumnTiles& tiles)
+{
+	const double scale(std::pow(2.0, zoom) * extent);// [tile units per normalized unit]
+	const double padding(static_cast<double>(buffer) / scale);
+	const double tileSize(static_cast<double>(extent) / scale);
+
+	Polygon column;
+	for (const auto& ring : polygon.polygon)
+	{
+		column.push_back(ClipRing(ring, x * tileSize - padding, (x + 1) * tileSize + padding, true));
+		if (column.front().size() < 3)
+			return;
+	}
+
+	uint32_t firstRow, lastRow;
+	GetTileRange(column.front(), zoom, false, firstRow, lastRow);
+	for (auto y = firstRow; y <= lastRow; ++y)
+	{
+		TileFeature feature;
+		feature.region = polygon.region;
+		for (const auto& ring : column)
+		{
+			std::vector<int32_t> tileRing;
+			const bool ringOK(ConvertToTileCoordinates(ClipRing(ring, y * tileSize - padding, (y + 1) * tileSize + padding, false), scale, x, y, tileRing));
+			if (ringOK)
+				feature.rings.push_back(std::move(tileRing));
+			else if (feature.rings.empty())
+				break;
+		}
+
+		if (feature.rings.empty())
+			continue;
+
+		auto& tileFeatures(tiles[y]);
+		if (!tileFeatures.empty() && tileFeatures.back().region == polygon.region)
+			tileFeatures.back().rings.insert(tileFeatures.back().rings.end(), feature.rings.begin(), feature.rings.end());
+		else
+			tileFeatures.push_back(std::move(feature));
+	}
+}
+
+// Points which round to the same tile coordinate are merged; returns false if fewer than three points remain
+bool VectorTileBuilder::ConvertToTileCoordinates(const Ring& ring, const double& scale, const uint32_t& x, const uint32_t& y, std::vector<int32_t>& tileRing)
+{
+	tileRing.clear();
+	for (const auto& p : ring)
+	{
+		const auto tileX(static_cast<int32_t>(std::lround(p.x * scale - static_cast<double>(x) * extent)));
+		const auto tileY(static_cast<int32_t>(std::lround(p.y * scale - static_cast<double>(y) * extent)));
+		if (tileRing.size() >= 2 && tileRing[tileRing.size() - 2] == tileX && tileRing.back() == tileY)
+			continue;
+
+		tileRing.push_back(tileX);
+		tileRing.push_back(tileY);
+	}
+
+	while (tileRing.size() >= 4 && tileRing[0] == tileRing[tileRing.size() - 2] && tileRing[1] == tileRing.back())
+		tileRing.resize(tileRing.size() - 2);
+
+	return tileRing.size() >= 6;
+}
+
+// Web mercator projection of longitude (x) and latitude (y) [deg] onto the unit square (origin at upper-left)
+Point VectorTileBuilder::Project(const Point& p)
+{
+	const double maxLatitude(85.0511287798);// [deg]
+	const double pi(4.0 * std::atan(1.0));
+	const double latitude(std::min(maxLatitude, std::max(-maxLatitude, p.y)) * pi / 180.0);
+
+	Point projected;
+	projected.x = (p.x + 180.0) / 360.0;
+	projected.y = 0.5 - std::log(std::tan(0.25 * pi + 0.5 * latitude)) / (2.0 * pi);
+	return projected;
+}
+
+VectorTileBuilder::Ring VectorTileBuilder::ClipRing(const Ring& ring, const double& minValue, const double& maxValue, const bool& clipX)
+{
+	return ClipRingToEdge(ClipRingToEdge(ring, minValue, true, clipX), maxValue, false, clipX);
+}
+
+// Sutherland-Hodgman clipping against a single edge (x = edge if clipX is true, otherwise y = edge)
+VectorTileBuilder::Ring VectorTileBuilder::ClipRingToEdge(const Ring& ring, const double& edge, const bool& keepGreater, const bool& clipX)
+{
+	Ring clipped;
+	if (ring.empty())
+		return clipped;
+
+	const auto isInside([&edge, &keepGreater, &clipX](const Point& p)
+	{
+		const double value(clipX ? p.x : p.y);
+		return keepGreater ? value >= edge : value <= edge;
+	});
+
+	const auto intersect([&edge, &clipX](const Point& a, const Point& b)
+	{
+		const double t(clipX ? (edge - a.x) / (b.x - a.x) : (edge - a.y) / (b.y - a.y));
+		Point p;
+		p.x = clipX ? edge : a.x + t * (b.x - a.x);
+		p.y = clipX ? a.y + t * (b.y - a.y) : edge;
+		return p;
+	});
+
+	const Point* previous(&ring.back());
+	for (const auto& current : ring)
+	{
+		const bool currentIsInside(isInside(current));
+		if (currentIsInside != isInside(*previous))
+			clipped.push_back(intersect(*previous, current));
+		if (currentIsInside)
+			clipped.push_back(current);
+		previous = &current;
+	}
+
+	return clipped;
+}
+
+bool VectorTileBuilder::WriteTile(const std::string& path, const unsigned int& zoom, const TileKey& key, const std::vector<TileFeature>& features)
+{
+	const std::filesystem::path directory(std::filesystem::path(path) / std::to_string(zoom) / std::to_string(key.first));
+	std::error_code error;
+	std::filesystem::create_directories(directory, error);
+	if (error)
+	{
+		std::cerr << "Failed to create directory '" << directory.string() << "'\n";
+		return false;
+	}
+
+	const auto fileName(directory / (std::to_string(key.second) + ".json"));
+	std::ofstream file(fileName);
+	if (!file.is_open() || !file.good())
+	{
+		std::cerr << "Failed to open '" << fileName.string() << "' for output\n";
+		return false;
+	}
+
+	JSONWriter writer(file);
+	writer.BeginObject();
+	writer.Key("features");
+	writer.BeginArray();
+	for (const auto& feature : features)
+	{
+		writer.BeginObject();
+		writer.Key("index");
+		writer.Integer(static_cast<int64_t>(feature.region));
+		writer.Key("rings");
+		writer.BeginArray();
+		for (const auto& ring : feature.rings)
+		{
+			writer.BeginArray();
+			for (const auto& value : ring)
+				writer.Integer(value);
+			writer.EndArray();
+		}
+		writer.EndArray();
+		writer.EndObject();
+	}
+	writer.EndArray();
+	writer.EndObject();
+
+	if (!writer.Flush())
+	{
+		std::cerr << "Failed to write to '" << fileName.string() << "'\n";
+		return false;
+	}
+
+	return true;
+}
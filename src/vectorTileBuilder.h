@@ -0,0 +1,71 @@
+// File:  vectorTileBuilder.h
+// Date:  10/18/2026
+// Auth:  K. Loux
+// Desc:  Writes region geometry as a static pyramid of vector tiles.
+
+#ifndef VECTOR_TILE_BUILDER_H_
+#define VECTOR_TILE_BUILDER_H_
+
+// Local headers
+#include "topologyBuilder.h"
+#include "point.h"
+
+// Standard C++ headers
+#include <vector>
+#include <map>
+#include <string>
+#include <cstdint>
+
+// Tiles use the standard web mercator z/x/y scheme and are stored as JSON files (<path>/z/x/y.json).  Each
+// tile contains the regions which intersect it, clipped to the tile (plus a small buffer) and using the
+// geometry level appropriate for the zoom.  Coordinates are integers relative to the tile's upper-left corner.
+class VectorTileBuilder
+{
+public:
+	VectorTileBuilder(const TopologyBuilder& topology, const std::vector<double>& reductionLimits);
+
+	bool WriteTiles(const std::string& path, const unsigned int& maxZoom) const;
+
+	static const int extent;// Tile coordinates range from 0 to extent
+
+private:
+	static const int buffer;// [tile units] Geometry extends beyond the tile edges so clipped edges are never visible
+
+	const TopologyBuilder& topology;
+	const std::vector<double> reductionLimits;
+
+	typedef std::vector<Point> Ring;// Normalized web mercator coordinates (0 to 1), not closed
+	typedef std::vector<Ring> Polygon;// First ring is the outer boundary
+
+	struct TileFeature
+	{
+		std::size_t region;
+		std::vector<std::vector<int32_t>> rings;// Interleaved x and y
+	};
+
+	struct RegionPolygon
+	{
+		std::size_t region;
+		Polygon polygon;
+		uint32_t firstColumn;
+		uint32_t lastColumn;
+	};
+
+	typedef std::pair<uint32_t, uint32_t> TileKey;// x, y
+	typedef std::map<uint32_t, std::vector<TileFeature>> ColumnTiles;// key is y
+
+	unsigned int ChooseLevel(const unsigned int& zoom) const;
+	std::vector<RegionPolygon> GetProjectedPolygons(const unsigned int& zoom) const;
+	std::vector<Polygon> GetProjectedPolygons(const std::size_t& region, const unsigned int& level) const;
+	static void GetTileRange(const Ring& ring, const unsigned int& zoom, const bool& useX, uint32_t& first, uint32_t& last);
+	static void AddPolygon(const RegionPolygon& polygon, const unsigned int& zoom, const uint32_t& x, ColumnTiles& tiles);
+	static bool ConvertToTileCoordinates(const Ring& ring, const double& scale, const uint32_t& x, const uint32_t& y, std::vector<int32_t>& tileRing);
+
+	static Point Project(const Point& p);
+	static Ring ClipRing(const Ring& ring, const double& minValue, const double& maxValue, const bool& clipX);
+	static Ring ClipRingToEdge(const Ring& ring, const double& edge, const bool& keepGreater, const bool& clipX);
+
+	static bool WriteTile(const std::string& path, const unsigned int& zoom, const TileKey& key, const std::vector<TileFeature>& features);
+};
+
+#endif// VECTOR_TILE_BUILDER_H_
@@ -12,6 +12,8 @@
 
 Zipper::~Zipper()
 {
+	if (openFile)
+		CloseFileForReading();
 	if (archive)
 		CloseArchive();
 }
@@ -31,6 +33,7 @@ bool Zipper::OpenArchiveBytes(const std::string& bytes)
 bool Zipper::CloseArchive()
 {
 	assert(archive && "Archive not yet open");
+	assert(!openFile && "Must close file before closing archive");
 
 	if (writeChanges)
 	{
@@ -185,3 +188,25 @@ bool Zipper::AddFile(const UString::String& fileNameInArchive, std::string& byte
 
 	return zip_file_add(archive, UString::ToNarrowString(fileNameInArchive).c_str(), buffer, ZIP_FL_ENC_UTF_8) >= 0;
 }
+
+bool Zipper::OpenFileForReading(const zip_int64_t& index)
+{
+	assert(archive && "Archive not yet open");
+	assert(!openFile && "Must only open one file at a time per object");
+	openFile = zip_fopen_index(archive, index, 0);
+	return openFile != nullptr;
+}
+
+zip_int64_t Zipper::ReadFromFile(char* buffer, const zip_uint64_t& size)
+{
+	assert(openFile && "File not yet open");
+	return zip_fread(openFile, static_cast<void*>(buffer), size);
+}
+
+bool Zipper::CloseFileForReading()
+{
+	assert(openFile && "File not yet open");
+	const bool success(zip_fclose(openFile) == 0);
+	openFile = nullptr;
+	return success;
+}
@@ -35,10 +35,16 @@ public:
 
 	bool AddFile(const UString::String& fileNameInArchive, std::string& bytes);
 
+	// For reading large files in pieces, rather than extracting the entire file at once
+	bool OpenFileForReading(const zip_int64_t& index);
+	zip_int64_t ReadFromFile(char* buffer, const zip_uint64_t& size);// Returns number of bytes read (zero at end of file) or -1 on error
+	bool CloseFileForReading();
+
 	UString::String GetErrorString() const;
 
 private:
 	zip_t* archive = nullptr;
+	zip_file_t* openFile = nullptr;
 	bool writeChanges = false;
 
 	bool ReadAndCloseFile(zip_file_t* file, std::string& bytes) const;